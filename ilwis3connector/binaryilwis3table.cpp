@@ -31,6 +31,8 @@ BinaryIlwis3Table::BinaryIlwis3Table() : _rows(0), _columns(0),_recordSize(0),_r
 }
 
 BinaryIlwis3Table::~BinaryIlwis3Table(){
+    if ( _records == 0) // nothing loaded or only mapped; the mapping goes with the file
+        return;
     if ( _columnInfo.size() != _columns) // may happen when invalid files are refused; destructor will try to clean up
         return;
 
@@ -68,12 +70,7 @@ bool BinaryIlwis3Table::load(const ODF& odf, const QString& prfix){
         kernel()->issues()->log(TR(ERR_INVALID_PROPERTY_FOR_2).arg("records",odf->file()));
         return false;
     }
-    QString datafile = odf->value(prefix + "TableStore", "Data");
-    //TODO: changes this container model
-    QUrl  url(odf->file());
-    QFileInfo inf = url.toLocalFile();
-    datafile = inf.absolutePath() + "/" + datafile;
-    QFile file(datafile);
+    QFile file(dataFile(odf, prefix));
 
     if (!file.exists()){
         kernel()->issues()->log(TR(ERR_MISSING_DATA_FILE_1).arg(file.fileName()));
@@ -103,6 +100,216 @@ bool BinaryIlwis3Table::load(const ODF& odf, const QString& prfix){
     return true;
 }
 
+bool BinaryIlwis3Table::map(const ODF &odf, const QString &prfix)
+{
+    Locker<> lock(_mutex);
+    if( _mapped)
+        return true;
+
+    QString prefix = prfix == "" ? "" : prfix + ":";
+
+    bool ok;
+    _columns = odf->value(prefix + "Table","Columns").toLong(&ok);
+    if (!ok) {
+        kernel()->issues()->log(TR(ERR_INVALID_PROPERTY_FOR_2).arg("column",odf->file()));
+        return false;
+    }
+    _rows = odf->value(prefix + "Table","Records").toLong(&ok);
+    if (!ok) {
+        kernel()->issues()->log(TR(ERR_INVALID_PROPERTY_FOR_2).arg("records",odf->file()));
+        return false;
+    }
+    _dataFile.setFileName(dataFile(odf, prefix));
+    if (!_dataFile.exists()){
+        kernel()->issues()->log(TR(ERR_MISSING_DATA_FILE_1).arg(_dataFile.fileName()));
+        return false;
+    }
+    if(!_dataFile.open(QIODevice::ReadOnly )){
+        kernel()->issues()->log(TR(ERR_COULD_NOT_OPEN_READING_1).arg(_dataFile.fileName()));
+        return false;
+    }
+    getColumnInfo(odf, prefix);
+
+    // the pages of the file are shared with the file system cache; no copy of the data is made
+    _mappedSize = _dataFile.size();
+    _mapped = _dataFile.map(0, _mappedSize);
+    if ( !_mapped) {
+        kernel()->issues()->log(TR(ERR_COULD_NOT_OPEN_READING_1).arg(_dataFile.fileName()));
+        return false;
+    }
+    computeFileLayout();
+    if ( _fixedRecords ? HEADER_SIZE + (quint64)_fileRecordSize * _rows > (quint64)_mappedSize : _rowOffsets.size() != _rows) {
+        kernel()->issues()->log(TR(ERR_COULD_NOT_LOAD_2).arg(_dataFile.fileName(), "table"));
+        _dataFile.unmap(const_cast<uchar *>(_mapped));
+        _mapped = 0;
+        return false;
+    }
+    return true;
+}
+
+QString BinaryIlwis3Table::dataFile(const ODF &odf, const QString &prefix) const
+{
+    QString datafile = odf->value(prefix + "TableStore", "Data");
+    //TODO: changes this container model
+    QUrl  url(odf->file());
+    QFileInfo inf = url.toLocalFile();
+    return inf.absolutePath() + "/" + datafile;
+}
+
+void BinaryIlwis3Table::computeFileLayout()
+{
+    _fixedRecords = true;
+    _fileRecordSize = 0;
+    for(ColumnInfo& info : _columnInfo) {
+        if ( info._type == itSTRING || info._type == itBINARY) {
+            _fixedRecords = false;
+            continue;
+        }
+        info._fileOffset = _fileRecordSize;
+        _fileRecordSize += info._fieldSize;
+    }
+    if ( _fixedRecords)
+        return;
+
+    // strings and coordinate buffers differ in length per record; one pass finds where the records start
+    _rowOffsets.clear();
+    _rowOffsets.reserve(_rows);
+    quint64 offset = HEADER_SIZE;
+    for(quint32 r = 0; r < _rows; ++r) {
+        _rowOffsets.push_back(offset);
+        for(const ColumnInfo& info : _columnInfo) {
+            qint64 length = fieldLength(offset, info);
+            if ( length < 0) {
+                _rowOffsets.pop_back();
+                return;
+            }
+            offset += length;
+        }
+    }
+}
+
+qint64 BinaryIlwis3Table::fieldLength(quint64 offset, const ColumnInfo &info) const
+{
+    if ( offset >= (quint64)_mappedSize)
+        return -1;
+    if ( info._type == itSTRING) {
+        const void *end = memchr(_mapped + offset, 0, _mappedSize - offset);
+        return end ? (const uchar *)end - (_mapped + offset) + 1 : -1;
+    }
+    if ( info._type == itBINARY) {
+        if ( offset + 4 > (quint64)_mappedSize)
+            return -1;
+        qint32 count;
+        memcpy(&count, _mapped + offset, 4);
+        return count < 0 ? -1 : count + 4;
+    }
+    return info._fieldSize;
+}
+
+bool BinaryIlwis3Table::cellOffsets(quint32 column, std::vector<quint64> &offsets) const
+{
+    if ( !_mapped || column >= _columns)
+        return false;
+    offsets.resize(_rows);
+    if ( _fixedRecords) {
+        for(quint32 r = 0; r < _rows; ++r)
+            offsets[r] = HEADER_SIZE + (quint64)r * _fileRecordSize + _columnInfo[column]._fileOffset;
+        return true;
+    }
+    for(quint32 r = 0; r < _rows; ++r) {
+        quint64 offset = _rowOffsets[r];
+        for(quint32 c = 0; c < column; ++c)
+            offset += fieldLength(offset, _columnInfo[c]);
+        offsets[r] = offset;
+    }
+    return true;
+}
+
+bool BinaryIlwis3Table::column(quint32 column, std::vector<double> &values) const
+{
+    if ( !_mapped || column >= _columns)
+        return false;
+    const ColumnInfo& info = _columnInfo[column];
+    if ( info._type != itINT32 && info._type != itDOUBLE)
+        return false;
+
+    values.resize(_rows);
+    if ( _fixedRecords) {
+        if ( info._type == itINT32) {
+            ColumnSpan<qint32> raws = span<qint32>(column);
+            for(quint32 r = 0; r < _rows; ++r)
+                values[r] = raws[r];
+        } else {
+            ColumnSpan<double> reals = span<double>(column);
+            for(quint32 r = 0; r < _rows; ++r)
+                values[r] = reals[r];
+        }
+        return true;
+    }
+    std::vector<quint64> offsets;
+    cellOffsets(column, offsets);
+    for(quint32 r = 0; r < _rows; ++r) {
+        if ( info._type == itINT32) {
+            qint32 raw;
+            memcpy(&raw, _mapped + offsets[r], 4);
+            values[r] = raw;
+        } else {
+            memcpy(&values[r], _mapped + offsets[r], 8);
+        }
+    }
+    return true;
+}
+
+bool BinaryIlwis3Table::column(quint32 column, std::vector<QString> &values) const
+{
+    if ( !_mapped || column >= _columns || _columnInfo[column]._type != itSTRING)
+        return false;
+    std::vector<quint64> offsets;
+    cellOffsets(column, offsets);
+    values.resize(_rows);
+    for(quint32 r = 0; r < _rows; ++r) {
+        qint64 length = fieldLength(offsets[r], _columnInfo[column]);
+        if ( length > 0)
+            values[r] = QString::fromLatin1((const char *)_mapped + offsets[r], length - 1);
+    }
+    return true;
+}
+
+/*!
+ \brief reads a coordinate buffer column of a mapped table into one contiguous array
+
+ The coordinates of row r are coords[starts[r]] up to coords[starts[r+1]]; starts has one more element than there are rows.
+*/
+bool BinaryIlwis3Table::coordinates(quint32 column, std::vector<geos::geom::Coordinate> &coords, std::vector<quint64> &starts) const
+{
+    if ( !_mapped || column >= _columns || _columnInfo[column]._type != itBINARY)
+        return false;
+    std::vector<quint64> offsets;
+    cellOffsets(column, offsets);
+    starts.resize(_rows + 1);
+    quint64 total = 0;
+    for(quint32 r = 0; r < _rows; ++r) {
+        qint32 bytes;
+        memcpy(&bytes, _mapped + offsets[r], 4);
+        if ( bytes < 0 || offsets[r] + 4 + bytes > (quint64)_mappedSize)
+            return false;
+        starts[r] = total;
+        total += bytes / 16;
+    }
+    starts[_rows] = total;
+
+    coords.resize(total);
+    for(quint32 r = 0; r < _rows; ++r) {
+        const uchar *p = _mapped + offsets[r] + 4;
+        for(quint64 i = starts[r]; i < starts[r + 1]; ++i, p += 16) {
+            double xy[2];
+            memcpy(xy, p, 16);
+            coords[i] = geos::geom::Coordinate(xy[0], xy[1], 0);
+        }
+    }
+    return true;
+}
+
 void BinaryIlwis3Table::getColumnInfo(const ODF& odf, const QString& prefix) {
     _columnInfo.resize(_columns);
     _recordSize = 0;
@@ -364,6 +571,12 @@ void BinaryIlwis3Table::addStoreDefinition(const DataDefinition& def) {
 }
 
 void BinaryIlwis3Table::storeRecord(std::ofstream& output_file, const std::vector<QVariant>& rec, int skip) {
+    QByteArray buffer;
+    storeRecord(buffer, rec, skip);
+    output_file.write(buffer.constData(), buffer.size());
+}
+
+void BinaryIlwis3Table::storeRecord(QByteArray& buffer, const std::vector<QVariant>& rec, int skip) {
     for(int x=0; x < rec.size(); ++x) {
         if ( x == skip)
             continue;
@@ -373,19 +586,19 @@ void BinaryIlwis3Table::storeRecord(std::ofstream& output_file, const std::vecto
             if ( conv.isNeutral()) {
                 if ( conv.storeType() == itINT32 && tp == itITEMDOMAIN) {
                     long val = rec[x].value<long>() + 1;
-                    output_file.write((char *)&val, 4);
+                    buffer.append((const char *)&val, 4);
                 }
                 else if ( conv.storeType() != itDOUBLE)    {
                     long val = rec[x].value<long>();
-                    output_file.write((char *)&val, 4);
+                    buffer.append((const char *)&val, 4);
                 } else {
                     double val = rec[x].value<double>();
-                    output_file.write((char *)&val, 8);
+                    buffer.append((const char *)&val, 8);
                 }
             } else {
                 double val = rec[x].value<double>();
                 long raw = conv.real2raw(val);
-                output_file.write((char *)&raw,  4);
+                buffer.append((const char *)&raw, 4);
             }
         }else {
 
@@ -393,32 +606,31 @@ void BinaryIlwis3Table::storeRecord(std::ofstream& output_file, const std::vecto
                 QString s = rec[x].value<QString>();
                 QByteArray bytes = s.toLocal8Bit();
                 const char * ptr = bytes.data();
-                output_file.write(ptr, s.size());
-                char c = 0;
-                output_file.write(&c, 1);
+                buffer.append(ptr, s.size());
+                buffer.append('\0');
 
             } else if ( tp == itCOORDDOMAIN) {
                 if ( rec[x].type() == QMetaType::QVariantList) {
                     const QList<QVariant> points = rec[x].toList();
                     long size = points.size();
-                    output_file.write((char *)&size, 4);
+                    buffer.append((const char *)&size, 4);
                     for(const QVariant& pnt : points) {
                         Coordinate crd = pnt.value<Coordinate>();
                         double v = crd.x;
-                        output_file.write((char *)&v, 8);
+                        buffer.append((const char *)&v, 8);
                         v = crd.y;
-                        output_file.write((char *)&v, 8);
+                        buffer.append((const char *)&v, 8);
                         v = 0;
-                        output_file.write((char *)&v, 8);
+                        buffer.append((const char *)&v, 8);
                     }
                 } else {
                     Coordinate crd =  rec[x].value<Coordinate>();
                     double v = crd.x;
-                    output_file.write((char *)&v, 8);
+                    buffer.append((const char *)&v, 8);
                     v = crd.y;
-                    output_file.write((char *)&v, 8);
+                    buffer.append((const char *)&v, 8);
                     v = 0;
-                    output_file.write((char *)&v, 8);
+                    buffer.append((const char *)&v, 8);
                 }
             }
         }
@@ -1,6 +1,8 @@
 #ifndef BINARYILWIS3TABLE_H
 #define BINARYILWIS3TABLE_H
 
+#include <QFile>
+
 namespace Ilwis {
 
 class DataDefinition;
@@ -15,6 +17,27 @@ struct Coordinate2d {
     double y;
 };
 
+/*!
+ \brief  strided, read only view on one fixed width column of a memory mapped table file
+
+ Values are read straight from the mapped file; nothing is copied until a value is asked for.
+*/
+template<typename T> class ColumnSpan {
+public:
+    ColumnSpan(const uchar *base=0, quint32 stride=0, quint32 count=0) : _base(base), _stride(stride), _count(count) {}
+    quint32 size() const { return _count; }
+    bool isValid() const { return _base != 0; }
+    T operator[](quint32 row) const {
+        T v;
+        memcpy(&v, _base + (quint64)row * _stride, sizeof(T)); // records are not aligned
+        return v;
+    }
+private:
+    const uchar *_base;
+    quint32 _stride;
+    quint32 _count;
+};
+
 class BinaryIlwis3Table
 {
 public:
@@ -22,6 +45,16 @@ public:
     ~BinaryIlwis3Table();
 
     bool load(const ODF &odf, const QString &prfix="");
+    bool map(const ODF &odf, const QString &prfix="");
+
+    template<typename T> ColumnSpan<T> span(quint32 column) const {
+        if ( !_mapped || !_fixedRecords || column >= _columns || _columnInfo[column]._fieldSize != (qint32)sizeof(T))
+            return ColumnSpan<T>();
+        return ColumnSpan<T>(_mapped + HEADER_SIZE + _columnInfo[column]._fileOffset, _fileRecordSize, _rows);
+    }
+    bool column(quint32 column, std::vector<double> &values) const;
+    bool column(quint32 column, std::vector<QString> &values) const;
+    bool coordinates(quint32 column, std::vector<geos::geom::Coordinate> &coords, std::vector<quint64> &starts) const;
 
     bool get(quint32 row, quint32 column, double &v) const;
     bool get(quint32 row, quint32 column, Coordinate &c) const;
@@ -34,7 +67,10 @@ public:
     QString columnName(int index);
     void addStoreDefinition(const DataDefinition &def);
     void storeRecord(std::ofstream &output_file, const std::vector<QVariant> &rec, int skip=iUNDEF);
+    void storeRecord(QByteArray &buffer, const std::vector<QVariant> &rec, int skip=iUNDEF);
     bool openOutput(const QString &basename, std::ofstream &output_file);
+
+    static const int OUTPUT_BUFFER_SIZE = 1 << 22; // records are collected up to this size before they are written
 private:
     struct ColumnInfo{
         bool _isRaw;
@@ -43,13 +79,21 @@ private:
         QString _name;
         RawConverter _conv;
         qint32 _fieldSize;
+        quint32 _fileOffset = 0; // position in a record of the data file, only meaningful when all fields have a fixed size
     };
+    static const quint32 HEADER_SIZE = 128;
     quint32 _rows;
     quint32 _columns;
     quint32 _recordSize;
     char * _records;
     QVector<ColumnInfo> _columnInfo;
     bool _loaded;
+    QFile _dataFile;
+    const uchar *_mapped = 0;
+    qint64 _mappedSize = 0;
+    bool _fixedRecords = true;
+    quint32 _fileRecordSize = 0;
+    std::vector<quint64> _rowOffsets; // start of each record in the mapped file, only used when records vary in size
 
     void getColumnInfo(const ODF &odf, const QString &prfix="");
     void readData(char *memblock);
@@ -57,6 +101,10 @@ private:
     char *readCoordList(char *mem, long &count);
     char *moveTo(int row, const ColumnInfo &fld) const;
     bool check(quint32 row, quint32 col) const;
+    QString dataFile(const ODF &odf, const QString &prefix) const;
+    void computeFileLayout();
+    bool cellOffsets(quint32 column, std::vector<quint64> &offsets) const;
+    qint64 fieldLength(quint64 offset, const ColumnInfo &info) const;
     std::recursive_mutex _mutex;
 
 };
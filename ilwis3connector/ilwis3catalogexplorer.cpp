@@ -1,3 +1,8 @@
+#include <future>
+#include <QThread>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QDir>
 #include "kernel.h"
 #include "connectorinterface.h"
 #include "mastercatalog.h"
@@ -44,8 +49,9 @@ std::vector<Resource> Ilwis3CatalogExplorer::loadItems(const IOOptions &)
                                                                  sfilters,
                                                                  CatalogConnector::foFULLPATHS | CatalogConnector::foEXTENSIONFILTER);
 
-    std::set<ODFItem> odfitems;
     std::vector<Resource> existingItems;
+    std::vector<QFileInfo> newFiles;
+    std::vector<QUrl> newUrls;
     QHash<QString, quint64> names;
     kernel()->issues()->silent(true);  // error messages during scan are not needed
     try{
@@ -55,9 +61,8 @@ std::vector<Resource> Ilwis3CatalogExplorer::loadItems(const IOOptions &)
         quint64 id = i64UNDEF;
         if ( (id = mastercatalog()->url2id(url, tp)) == i64UNDEF) {
             if ( tp & itILWISOBJECT ) {
-                ODFItem item(file);
-                odfitems.insert(item);
-                names[url.toString().toLower()] = item.id();
+                newFiles.push_back(file);
+                newUrls.push_back(url);
             }
         }else {
             Resource res = mastercatalog()->id2Resource(id);
@@ -66,6 +71,26 @@ std::vector<Resource> Ilwis3CatalogExplorer::loadItems(const IOOptions &)
 
     }
 
+    FolderIndex index = loadIndex();
+    FolderIndex newIndex;
+    quint32 parsed = 0;
+    std::vector<ODFItem> created = createItems(newFiles, index, newIndex, parsed);
+    std::set<ODFItem> odfitems;
+    for(quint32 i = 0; i < created.size(); ++i) {
+        odfitems.insert(created[i]);
+        names[newUrls[i].toString().toLower()] = created[i].id();
+    }
+
+    // files that are already known in this session keep their entry so the next session does not parse them
+    for(const Resource& res : existingItems) {
+        QString path = toLocalFile(res.url()).absoluteFilePath();
+        auto iter = index.find(path);
+        if ( iter != index.end())
+            newIndex[path] = iter->second;
+    }
+    if ( parsed > 0 || newIndex.size() != index.size())
+        storeIndex(newIndex);
+
     std::vector<ODFItem> items;
     for( const auto& item : odfitems){
         items.push_back(item);
@@ -92,6 +117,123 @@ std::vector<Resource> Ilwis3CatalogExplorer::loadItems(const IOOptions &)
     }
 }
 
+std::vector<ODFItem> Ilwis3CatalogExplorer::createItems(const std::vector<QFileInfo> &files, const FolderIndex &index, FolderIndex &newIndex, quint32 &parsed) const
+{
+    // unchanged files are taken from the index, the others are parsed in parallel. The workers only read files;
+    // types are completed from the mastercatalog on this thread, names are resolved when all items of the folder are known.
+    std::vector<std::unique_ptr<ODFItem>> items(files.size());
+    std::vector<quint32> toParse;
+    for(quint32 i = 0; i < files.size(); ++i) {
+        const QFileInfo& file = files[i];
+        auto iter = index.find(file.absoluteFilePath());
+        if ( iter != index.end() && isUnchanged(file, iter->second)) {
+            QDataStream stream(iter->second._item);
+            items[i].reset(new ODFItem(file, stream));
+            newIndex[file.absoluteFilePath()] = iter->second;
+        } else {
+            toParse.push_back(i);
+        }
+    }
+
+    quint32 threads = std::max(1, QThread::idealThreadCount());
+    quint32 chunk = (toParse.size() + threads - 1) / threads;
+    std::vector<std::future<void>> futures;
+    for(quint32 start = 0; start < toParse.size(); start += chunk) {
+        quint32 end = std::min((quint32)toParse.size(), start + chunk);
+        futures.push_back(std::async(std::launch::async, [&items, &files, &toParse, start, end]() {
+            for(quint32 i = start; i < end; ++i) {
+                quint32 fileIndex = toParse[i];
+                items[fileIndex].reset(new ODFItem(files[fileIndex]));
+            }
+        }));
+    }
+    for(auto& future : futures)
+        future.get(); // rethrows what went wrong in a worker
+    parsed = toParse.size();
+
+    std::vector<ODFItem> result;
+    result.reserve(files.size());
+    for(quint32 i : toParse) {
+        items[i]->resolveTypes();
+        IndexEntry entry;
+        entry._modified = files[i].lastModified().toMSecsSinceEpoch();
+        entry._size = files[i].size();
+        QDataStream stream(&entry._item, QIODevice::WriteOnly);
+        items[i]->storeIndex(stream);
+        entry._references = items[i]->references();
+        newIndex[files[i].absoluteFilePath()] = entry;
+    }
+    for(auto& item : items)
+        result.push_back(*item);
+    return result;
+}
+
+bool Ilwis3CatalogExplorer::isUnchanged(const QFileInfo &file, const IndexEntry &entry)
+{
+    if ( entry._modified != file.lastModified().toMSecsSinceEpoch() || entry._size != file.size())
+        return false;
+    // sizes and types also come from the domains, georeferences and data files the odf refers to
+    for(auto iter = entry._references.begin(); iter != entry._references.end(); ++iter) {
+        QFileInfo inf(iter.key());
+        qint64 modified = inf.exists() ? inf.lastModified().toMSecsSinceEpoch() : -1;
+        if ( modified != iter.value())
+            return false;
+    }
+    return true;
+}
+
+QString Ilwis3CatalogExplorer::indexPath() const
+{
+    QString internal = context()->persistentInternalCatalog().toLocalFile();
+    if ( internal == "")
+        return "";
+    QString folder = QFileInfo(source().url().toLocalFile()).canonicalFilePath();
+    QString hash = QCryptographicHash::hash(folder.toUtf8(), QCryptographicHash::Md5).toHex();
+    return internal + "/ilwis3index/" + hash + ".idx";
+}
+
+Ilwis3CatalogExplorer::FolderIndex Ilwis3CatalogExplorer::loadIndex() const
+{
+    FolderIndex index;
+    QFile file(indexPath());
+    if ( file.fileName() == "" || !file.open(QIODevice::ReadOnly))
+        return index;
+
+    QDataStream stream(&file);
+    QString magic;
+    quint32 version, count;
+    stream >> magic >> version >> count;
+    if ( magic != "ilwis3index" || version != 2)
+        return index;
+    for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        IndexEntry entry;
+        stream >> path >> entry._modified >> entry._size >> entry._item >> entry._references;
+        index[path] = entry;
+    }
+    if ( stream.status() != QDataStream::Ok) // a truncated index is not trusted at all
+        index.clear();
+    return index;
+}
+
+void Ilwis3CatalogExplorer::storeIndex(const FolderIndex &index) const
+{
+    QString path = indexPath();
+    if ( path == "")
+        return;
+    QFileInfo inf(path);
+    if ( !QDir().mkpath(inf.absolutePath()))
+        return;
+    QFile file(path);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+    QDataStream stream(&file);
+    stream << QString("ilwis3index") << (quint32)2 << (quint32)index.size();
+    for(const auto& entry : index) {
+        stream << entry.first << entry.second._modified << entry.second._size << entry.second._item << entry.second._references;
+    }
+}
+
 bool Ilwis3CatalogExplorer::canUse(const Resource &resource) const
 {
         if ( resource.ilwisType() != itCATALOG)
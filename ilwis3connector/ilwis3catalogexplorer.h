@@ -5,6 +5,8 @@ namespace Ilwis {
 
 namespace Ilwis3 {
 
+class ODFItem;
+
 class Ilwis3CatalogExplorer : public FolderCatalogExplorer
 {
 public:
@@ -17,7 +19,20 @@ public:
     static Ilwis::CatalogExplorer *create(const Ilwis::Resource &resource, const Ilwis::IOOptions &options);
     QFileInfo toLocalFile(const QUrl &datasource) const;
 private:
+    struct IndexEntry {
+        qint64 _modified = 0;
+        qint64 _size = 0;
+        QByteArray _item; // the properties of the ODFItem, see ODFItem::storeIndex
+        QMap<QString, qint64> _references; // see ODFItem::references
+    };
+    typedef std::map<QString, IndexEntry> FolderIndex;
+
     void registerNames(const QString &name, QHash<QString, quint64> &names);
+    std::vector<ODFItem> createItems(const std::vector<QFileInfo> &files, const FolderIndex &index, FolderIndex &newIndex, quint32 &parsed) const;
+    static bool isUnchanged(const QFileInfo &file, const IndexEntry &entry);
+    QString indexPath() const;
+    FolderIndex loadIndex() const;
+    void storeIndex(const FolderIndex &index) const;
 
     NEW_CATALOGEXPLORER(Ilwis3CatalogExplorer);
 };
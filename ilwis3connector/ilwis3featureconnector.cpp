@@ -1,7 +1,12 @@
+#include <future>
+#include <QThread>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <fstream>
 #include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <QHash>
 
 #include "coverage.h"
 #include "geos/geom/CoordinateArraySequence.h"
@@ -70,131 +75,164 @@ FeatureConnector::FeatureConnector(const Resource &resource, bool load, const IO
 
 bool FeatureConnector::loadBinaryPolygons30(FeatureCoverage *fcoverage, ITable& tbl) {
     BinaryIlwis3Table polTable;
-    if ( !polTable.load(_odf)) {
+    if ( !polTable.map(_odf)) {
         return ERROR1(ERR_COULD_NOT_OPEN_READING_1,_odf->file())    ;
     }
 
     BinaryIlwis3Table topTable;
-    if ( !topTable.load(_odf,"top")) {
+    Topology topology;
+    if ( !topTable.map(_odf,"top") || !loadTopology(topTable, topology)) {
         return ERROR1(ERR_COULD_NOT_OPEN_READING_1,_odf->file())    ;
     }
 
-    qint32 colValue = polTable.index("PolygonValue");
-    qint32 colTopStart = polTable.index("TopStart");
-    qint32 colArea = polTable.index("Area");
+    std::vector<double> values, topStarts, areas;
+    if (!polTable.column(polTable.index("PolygonValue"), values) ||
+        !polTable.column(polTable.index("TopStart"), topStarts) ||
+        !polTable.column(polTable.index("Area"), areas)) {
+        return ERROR1(ERR_COULD_NOT_OPEN_READING_1,_odf->file())    ;
+    }
     int nrPolygons = polTable.rows();
     bool isNumeric = _odf->value("BaseMap","Range") != sUNDEF;
 
-    double v;
+    // the rings of a polygon only depend on the topology, so polygons are assembled independently of each other
+    std::vector<std::vector<std::vector<geos::geom::Coordinate> *>> polygonRings(nrPolygons);
+    std::vector<char> assembled(nrPolygons, false);
+    quint32 threads = std::max(1, QThread::idealThreadCount());
+    quint32 chunk = (nrPolygons + threads - 1) / threads;
+    std::vector<std::future<void>> futures;
+    for(quint32 start = 0; start < (quint32)nrPolygons; start += chunk) {
+        quint32 end = std::min((quint32)nrPolygons, start + chunk);
+        futures.push_back(std::async(std::launch::async, [&, start, end]() {
+            for(quint32 i = start; i < end; ++i) {
+                if ( areas[i] < 0)
+                    continue;
+                assembled[i] = getRings((qint32)topStarts[i], topology, polygonRings[i]);
+            }
+        }));
+    }
+    for(auto& future : futures)
+        future.get();
+
     for(int i = 0; i < nrPolygons; ++i) {
-        polTable.get(i,colArea, v);
-        if ( v < 0)
+        std::vector<std::vector<geos::geom::Coordinate> *>& rings = polygonRings[i];
+        if ( !assembled[i] || rings.size() == 0)
             continue;
-        polTable.get(i,colTopStart,v);
-        qint32 index = v;
-        std::vector<geos::geom::LinearRing *> *rings = new std::vector<geos::geom::LinearRing *>();
-        if (getRings(fcoverage,index, topTable, polTable, rings)) {
-            if ( rings->size() == 0)
-                continue;
-            geos::geom::LinearRing *outer = rings->front();
-            vector<geos::geom::Geometry *> *geoms = new vector<geos::geom::Geometry *>(rings->size() - 1);
-            for(int j=1; j < rings->size(); ++j) {
-                (*geoms)[j-1] = rings->at(j);
-            }
+        std::vector<geos::geom::LinearRing *> linearRings(rings.size());
+        for(int j = 0; j < rings.size(); ++j) {
+            geos::geom::CoordinateArraySequence * ringIn = new geos::geom::CoordinateArraySequence(rings[j]);
+            ringIn->removeRepeatedPoints();
+            linearRings[j] = fcoverage->geomfactory()->createLinearRing(ringIn);
+        }
+        geos::geom::LinearRing *outer = linearRings.front();
+        vector<geos::geom::Geometry *> *geoms = new vector<geos::geom::Geometry *>(linearRings.begin() + 1, linearRings.end());
 
-            geos::geom::Polygon *polygon = fcoverage->geomfactory()->createPolygon(outer, geoms);
-            //std::copy(rings[0].begin(), rings[0].end(), polygon.outer().begin());
-            polTable.get(i, colValue, v);
-            if ( isNumeric) {
-                tbl->setCell(COVERAGEKEYCOLUMN, i, QVariant(i));
-                tbl->setCell(FEATUREVALUECOLUMN, i, QVariant(v));
-                fcoverage->newFeature({polygon}, false);
-            } else {
-                quint32 itemId = v;
-                tbl->setCell(COVERAGEKEYCOLUMN, i, QVariant(itemId - 1));
-                fcoverage->newFeature({polygon}, false);
-            }
+        geos::geom::Polygon *polygon = fcoverage->geomfactory()->createPolygon(outer, geoms);
+        double v = values[i];
+        if ( isNumeric) {
+            tbl->setCell(COVERAGEKEYCOLUMN, i, QVariant(i));
+            tbl->setCell(FEATUREVALUECOLUMN, i, QVariant(v));
+            fcoverage->newFeature({polygon}, false);
+        } else {
+            quint32 itemId = v;
+            tbl->setCell(COVERAGEKEYCOLUMN, i, QVariant(itemId - 1));
+            fcoverage->newFeature({polygon}, false);
         }
     }
     return true;
 }
 
-bool FeatureConnector::getRings(FeatureCoverage *fcoverage, qint32 startIndex, const BinaryIlwis3Table& topTable, const BinaryIlwis3Table& polTable, std::vector<geos::geom::LinearRing *> *rings ){
+bool FeatureConnector::loadTopology(const BinaryIlwis3Table &topTable, Topology &topology) const
+{
+    std::vector<double> links;
+    if ( !topTable.column(topTable.index("ForwardLink"), links))
+        return false;
+    topology._forward.assign(links.begin(), links.end());
+    if ( !topTable.column(topTable.index("BackwardLink"), links))
+        return false;
+    topology._backward.assign(links.begin(), links.end());
+
+    return topTable.coordinates(topTable.index("Coords"), topology._coords, topology._starts);
+}
+
+bool FeatureConnector::getRings(qint32 startIndex, const Topology& topology, std::vector<std::vector<geos::geom::Coordinate> *>& rings ) const{
     qint32 row = startIndex;
-    qint32 colCoords = topTable.index("Coords");
-    qint32 colForward = topTable.index("ForwardLink");
-    qint32 colBackward = topTable.index("BackwardLink");
-    std::vector<geos::geom::Coordinate> *ring;
-    bool forward = isForwardStartDirection(topTable,colForward, colBackward, colCoords, row);
+    quint32 rows = topology._forward.size();
+    if ( (quint32)abs(row) >= rows)
+        return false;
+    bool forward = isForwardStartDirection(topology, row);
+    std::vector<geos::geom::Coordinate> *ring = new std::vector<geos::geom::Coordinate>();
+    auto cleanup = [&]() {
+        delete ring;
+        for(auto *r : rings)
+            delete r;
+        rings.clear();
+        return false;
+    };
+    quint32 visited = 0;
     do{
-        std::vector<Coordinate> coords;
-        topTable.get(row,colCoords,coords);
-        if( coords.size() == 0 ||coords.back() == coords.front()){
-            ring = new std::vector<geos::geom::Coordinate>(coords.size());
-            std::copy(coords.begin(), coords.end(), ring->begin());
-        } else if ( coords.back() == ring->back()) {
-            ring = new std::vector<geos::geom::Coordinate>(coords.size());
-            std::reverse_copy(coords.begin(), coords.end(), ring->begin());
-        } else if ( ring->front() == coords.front()) {
-            ring = new std::vector<geos::geom::Coordinate>(coords.size());
-            std::reverse_copy(coords.begin(), coords.end(), ring->begin());
-        } else if ( ring->front() == coords.back()) {
-            ring = new std::vector<geos::geom::Coordinate>(coords.size());
-            std::copy(coords.begin(), coords.end(), ring->begin());
+        quint32 current = abs(row);
+        if ( current >= rows || ++visited > rows) // a walk can never be longer than the table; corrupt data
+            return cleanup();
+        const geos::geom::Coordinate *first = topology._coords.data() + topology._starts[current];
+        const geos::geom::Coordinate *last = topology._coords.data() + topology._starts[current + 1];
+        if ( first != last) {
+            bool reverse = !forward;
+            if ( ring->size() > 0) { // follow the coordinates, they decide where the segment connects
+                if ( ring->back() == *first)
+                    reverse = false;
+                else if ( ring->back() == *(last - 1))
+                    reverse = true;
+            }
+            if ( reverse)
+                ring->insert(ring->end(), std::reverse_iterator<const geos::geom::Coordinate *>(last), std::reverse_iterator<const geos::geom::Coordinate *>(first));
+            else
+                ring->insert(ring->end(), first, last);
         }
 
         if ( ring->size() > 3 && ring->front() == ring->back()) {
-            geos::geom::CoordinateArraySequence * ringIn = new geos::geom::CoordinateArraySequence(ring);
-            ringIn->removeRepeatedPoints();
-            rings->push_back( fcoverage->geomfactory()->createLinearRing(ringIn));
-            coords.clear();
+            rings.push_back(ring);
+            ring = new std::vector<geos::geom::Coordinate>();
         }
         qint32 oldIndex = row;
-        double v;
-        if ( forward)
-            topTable.get(abs(row),colForward,v);
-        else
-            topTable.get(abs(row), colBackward, v);\
-        row = v;
+        row = forward ? topology._forward[current] : topology._backward[current];
         if ( oldIndex == row && row != startIndex) // this would indicate infintite loop. corrupt data
-            return false;
+            return cleanup();
         forward = row > 0;
     } while(abs(row) != abs(startIndex) && row != iUNDEF);
+    delete ring;
 
     return true;
 }
 
-bool FeatureConnector::isForwardStartDirection(const BinaryIlwis3Table& topTable, qint32 colForward, qint32 colBackward, qint32 colCoords, long index) {
-    qint32 fwl, bwl;
-    double v;
-    topTable.get(abs(index),colForward, v );
-    fwl = v;
+bool FeatureConnector::isForwardStartDirection(const Topology& topology, long index) const {
+    qint32 fwl = topology._forward[abs(index)];
     if ( fwl != iUNDEF)
         --fwl; // due to being raw values
-    topTable.get(abs(index),colBackward, v );
-    bwl = v;
+    qint32 bwl = topology._backward[abs(index)];
     if ( bwl != iUNDEF)
         --bwl;
 
     if ( abs(fwl) == abs(bwl)	)
         return true;
-    if ( index < 0)
+    if ( index < 0 || fwl == iUNDEF || (quint32)abs(fwl) >= topology._forward.size())
+        return false;
+    const geos::geom::Coordinate *startLine = topology._coords.data() + topology._starts[abs(index)];
+    quint64 startCount = topology._starts[abs(index) + 1] - topology._starts[abs(index)];
+    const geos::geom::Coordinate *forwardLine = topology._coords.data() + topology._starts[abs(fwl)];
+    quint64 forwardCount = topology._starts[abs(fwl) + 1] - topology._starts[abs(fwl)];
+    if ( startCount == 0 || forwardCount == 0)
         return false;
-    std::vector<Coordinate> startLine, forwardLine;
-    topTable.get(abs(index), colCoords,startLine);
-    topTable.get(abs(fwl), colCoords, forwardLine);
 
     bool forward = false;
     if ( fwl > 0)
-        forward =  startLine.back() == forwardLine.front();
+        forward =  startLine[startCount - 1] == forwardLine[0];
     else
-        forward = startLine.back() == forwardLine.back();
+        forward = startLine[startCount - 1] == forwardLine[forwardCount - 1];
 
     return forward;
 
 }
 
-
 bool FeatureConnector::loadBinaryPolygons37(FeatureCoverage *fcoverage, ITable& tbl) {
     QString datafile = _odf->value("PolygonMapStore","DataPol");
     datafile = QFileInfo(QUrl(_odf->file()).toLocalFile()).absolutePath() + "/" + datafile;
@@ -208,65 +246,107 @@ bool FeatureConnector::loadBinaryPolygons37(FeatureCoverage *fcoverage, ITable&
         kernel()->issues()->log(TR(ERR_COULD_NOT_OPEN_READING_1).arg(file.fileName()));
         return false;
     }
-    QDataStream stream(&file);
+    // the whole file is mapped; rings are copied from it in one go per ring
+    const char *data = (const char *)file.map(0, file.size());
+    if ( !data) {
+        kernel()->issues()->log(TR(ERR_COULD_NOT_OPEN_READING_1).arg(file.fileName()));
+        return false;
+    }
+    const char *end = data + file.size();
+
     int nrPolygons = fcoverage->featureCount(itPOLYGON);
     bool isNumeric = _odf->value("BaseMap","Range") != sUNDEF;
-    map<quint32,vector<geos::geom::Geometry *>> polygons;
-    std::vector<double> featureValues(isNumeric ? nrPolygons : 0);
+    // polygons with the same raw value become one multipolygon, so those can only be added once all are read.
+    // In value maps every polygon is a feature of its own and is added as soon as it is read.
+    QHash<quint32,vector<geos::geom::Geometry *>> polygons;
+    ColumnDefinition& coldef = fcoverage->attributeDefinitionsRef().columndefinitionRef(isNumeric ? FEATUREVALUECOLUMN : COVERAGEKEYCOLUMN);
+    coldef.datadef().range(Range::create(coldef.datadef().range<>()->valueType())); // resetting the range to a default state
     fcoverage->setFeatureCount(itPOLYGON, iUNDEF,0); // metadata already set it to correct number, creating new features will up the count agains; so reset to 0.
     for(int j=0; j < nrPolygons; ++j) {
-        geos::geom::CoordinateArraySequence *outer = readRing(stream);
-        if ( !outer)
+        geos::geom::CoordinateArraySequence *outer = readRing(data, end);
+        if ( !outer || data + 12 > end) {
+            delete outer;
+            ERROR1(ERR_COULD_NOT_OPEN_READING_1,"data file");
             return false;
+        }
 
         geos::geom::LinearRing *outerring = fcoverage->geomfactory()->createLinearRing(outer);
         double value;
 
         quint32 numberOfHoles;
-        stream.readRawData((char *)&value, 8);
-        stream.readRawData((char *)&numberOfHoles, 4);
-        std::vector<geos::geom::Geometry*> *inners = new std::vector<geos::geom::Geometry*>(numberOfHoles);
-        for(quint32 i=0; i< numberOfHoles;++i)
-            (*inners)[i] = fcoverage->geomfactory()->createLinearRing(readRing(stream));
+        memcpy(&value, data, 8);
+        memcpy(&numberOfHoles, data + 8, 4);
+        data += 12;
+        std::vector<geos::geom::Geometry*> *inners = new std::vector<geos::geom::Geometry*>();
+        inners->reserve(numberOfHoles);
+        for(quint32 i=0; i< numberOfHoles;++i) {
+            geos::geom::CoordinateArraySequence *hole = readRing(data, end);
+            if ( !hole) {
+                for(geos::geom::Geometry *ring : *inners)
+                    delete ring;
+                delete inners;
+                delete outerring;
+                ERROR1(ERR_COULD_NOT_OPEN_READING_1,"data file");
+                return false;
+            }
+            inners->push_back(fcoverage->geomfactory()->createLinearRing(hole));
+        }
         geos::geom::Polygon *pol = fcoverage->geomfactory()->createPolygon(outerring, inners);
 
-        //collect all polygons in a map; the key is either a unique number ( index j) or the raw value from the polygon
-        //in this way all polygons with the same raw value will become a multipolygon
-        polygons[isNumeric ? j + 1 : (quint32)value].push_back(pol);
         if ( isNumeric) {
-            featureValues[j] = value;
+            auto feature = fcoverage->newFeature({pol},false);
+            feature(FEATUREVALUECOLUMN, QVariant(value));
+        } else {
+            polygons[(quint32)value].push_back(pol);
         }
     }
-    addFeatures(polygons, fcoverage,featureValues, itPOLYGON);
+    if ( !isNumeric) {
+        addFeatures(polygons, fcoverage, itPOLYGON);
+    }
     file.close();
 
     return true;
 }
 
+void FeatureConnector::addFeatures(QHash<quint32, vector<geos::geom::Geometry *> > &geometries, FeatureCoverage *fcoverage, IlwisTypes tp)
+{
+    // same order as the raw values, the records of the attribute table follow that order
+    std::vector<quint32> keys = geometries.keys().toVector().toStdVector();
+    std::sort(keys.begin(), keys.end());
+    quint32 rec = 0;
+    ColumnDefinition& coldef = fcoverage->attributeDefinitionsRef().columndefinitionRef(COVERAGEKEYCOLUMN);
+    for(quint32 key : keys) {
+        vector<geos::geom::Geometry *>& geoms = geometries[key];
+        geos::geom::Geometry *geometry = geoms.size() == 1 ? geoms[0] : createMultiGeometry(fcoverage, geoms, tp);
+        auto feature = fcoverage->newFeature({geometry},false);
+        feature(COVERAGEKEYCOLUMN, QVariant(key - 1));
+        ++rec;
+    }
+    coldef.datadef().range<IndexedIdentifierRange>()->add(new IndexedIdentifier("",0,rec));
+}
+
+geos::geom::Geometry *FeatureConnector::createMultiGeometry(FeatureCoverage *fcoverage, const vector<geos::geom::Geometry *> &geometries, IlwisTypes tp) const
+{
+    std::vector<geos::geom::Geometry *> *geoms = new std::vector<geos::geom::Geometry *>(geometries);
+    switch(tp) {
+        case itPOLYGON:
+            return fcoverage->geomfactory()->createMultiPolygon(geoms);
+        case itLINE:
+            return fcoverage->geomfactory()->createMultiLineString(geoms);
+        case itPOINT:
+            return fcoverage->geomfactory()->createMultiPoint(geoms);
+    }
+    delete geoms;
+    return 0;
+}
+
 void  FeatureConnector::addFeatures(map<quint32,vector<geos::geom::Geometry *>>& geometries,FeatureCoverage *fcoverage,const std::vector<double>& featureValues, IlwisTypes tp) {
     quint32 rec = 0;
     ColumnDefinition& coldef = fcoverage->attributeDefinitionsRef().columndefinitionRef(featureValues.size() > 0 ? FEATUREVALUECOLUMN : COVERAGEKEYCOLUMN);
     coldef.datadef().range(Range::create(coldef.datadef().range<>()->valueType())); // resetting the range to a default state
     for(auto iter = geometries.begin() ; iter != geometries.end(); ++iter) {
         vector<geos::geom::Geometry *>& geoms1 = (*iter).second;
-        geos::geom::Geometry *geometry = 0;
-        if ( geoms1.size() == 1) {
-            geometry = geoms1[0];
-        } else {
-            std::vector<geos::geom::Geometry *> *geoms = new std::vector<geos::geom::Geometry *>((*iter).second);
-//            geos::geom::GeometryCollection *multigeom = 0;
-            switch(tp) {
-                case itPOLYGON:
-                    geometry = fcoverage->geomfactory()->createMultiPolygon(geoms); break;
-                case itLINE:
-                    geometry = fcoverage->geomfactory()->createMultiLineString(geoms); break;
-                case itPOINT:
-                    geometry = fcoverage->geomfactory()->createMultiPoint(geoms); break;
-            }
-
-
-//            fcoverage->newFeature({multigeom},false);
-        }
+        geos::geom::Geometry *geometry = geoms1.size() == 1 ? geoms1[0] : createMultiGeometry(fcoverage, geoms1, tp);
         auto feature = fcoverage->newFeature({geometry},false);
         if ( featureValues.size() > 0){
             QVariant value(featureValues[rec]);
@@ -284,21 +364,23 @@ void  FeatureConnector::addFeatures(map<quint32,vector<geos::geom::Geometry *>>&
     }
 }
 
-geos::geom::CoordinateArraySequence* FeatureConnector::readRing(QDataStream& stream ) {
+geos::geom::CoordinateArraySequence* FeatureConnector::readRing(const char *&data, const char *end) {
     quint32 numberOfCoords;
-
-    if (stream.readRawData((char *)&numberOfCoords, 4) <= 0){
-        ERROR1(ERR_COULD_NOT_OPEN_READING_1,"data file");
+    if ( data + 4 > end)
         return 0;
-    }
-    vector<XYZ> pnts(numberOfCoords);
-    stream.readRawData((char *)&pnts[0],numberOfCoords*3*8);
-    geos::geom::CoordinateArraySequence *ring = new geos::geom::CoordinateArraySequence(numberOfCoords);
-    for(quint32 i=0; i < numberOfCoords; ++i) {
-        ring->setAt(geos::geom::Coordinate(pnts[i].x, pnts[i].y, pnts[i].z), i);
-    }
+    memcpy(&numberOfCoords, data, 4);
+    data += 4;
+    if ( (quint64)(end - data) < (quint64)numberOfCoords * sizeof(XYZ))
+        return 0;
+
+    // a geos coordinate is three doubles, as are the coordinates in the file
+    std::vector<geos::geom::Coordinate> *coords = new std::vector<geos::geom::Coordinate>(numberOfCoords);
+    static_assert(sizeof(geos::geom::Coordinate) == sizeof(XYZ), "coordinate layout differs from the ilwis3 file layout");
+    if ( numberOfCoords > 0)
+        memcpy((char *)&(*coords)[0], data, numberOfCoords * sizeof(XYZ));
+    data += numberOfCoords * sizeof(XYZ);
 
-   return ring;
+   return new geos::geom::CoordinateArraySequence(coords);
 }
 
 bool FeatureConnector::loadBinaryPolygons(FeatureCoverage *fcoverage) {
@@ -468,96 +550,154 @@ bool FeatureConnector::loadMetaData(Ilwis::IlwisObject *obj,const IOOptions& opt
 
 }
 
-void FeatureConnector::writePolygon(const geos::geom::Polygon* polygon, std::ofstream& output_file, double raw){
-    if (!polygon)
-        return;
+void FeatureConnector::appendCoords(QByteArray& buffer, const geos::geom::CoordinateSequence *coords) const{
+    quint32 crdCount = coords->getSize();
+    buffer.append((const char *)&crdCount, 4);
+    int offset = buffer.size();
+    buffer.resize(offset + crdCount * 8 * 3);
+    char *p = buffer.data() + offset;
+    for(quint32 i = 0; i < crdCount; ++i, p += 24) {
+        const geos::geom::Coordinate& crd = coords->getAt(i);
+        double xyz[3] = {crd.x, crd.y, 0};
+        memcpy(p, xyz, 24);
+    }
+}
 
-    const std::vector<geos::geom::Coordinate>* coords = polygon->getExteriorRing()->getCoordinates()->toVector();
-    writeCoords(output_file, coords);
-    output_file.write((char *)&raw,8);
+void FeatureConnector::appendPolygon(QByteArray& buffer, const geos::geom::Polygon* polygon, double raw) const{
+    appendCoords(buffer, polygon->getExteriorRing()->getCoordinatesRO());
+    buffer.append((const char *)&raw,8);
     quint32 holeCount = polygon->getNumInteriorRing();
-    output_file.write((char *)&holeCount,4);
-    for(int i=0; i < holeCount; ++i ) {
-        const std::vector<geos::geom::Coordinate>* coords = polygon->getInteriorRingN(i)->getCoordinates()->toVector();
-        writeCoords(output_file, coords);
+    buffer.append((const char *)&holeCount,4);
+    for(quint32 i=0; i < holeCount; ++i ) {
+        appendCoords(buffer, polygon->getInteriorRingN(i)->getCoordinatesRO());
     }
 }
 
-bool FeatureConnector::storeBinaryDataPolygon(FeatureCoverage *fcov, const QString& baseName) {
-    QString filename = baseName + ".mpz#";
+void FeatureConnector::appendLine(QByteArray& buffer, const geos::geom::LineString* line, qint32 raw ) const{
+    const geos::geom::Envelope *env = line->getEnvelopeInternal();
+    double box[4] = {env->getMinX(), env->getMinY(), env->getMaxX(), env->getMaxY()};
+    buffer.append((const char *)box, 32);
+    const geos::geom::CoordinateSequence *coords = line->getCoordinatesRO();
+    qint32 noOfCoordsBytes = coords->getSize() * 16;
+    buffer.append((const char *)&noOfCoordsBytes, 4);
+    for(quint32 i = 0; i < coords->getSize(); ++i) {
+        const geos::geom::Coordinate& crd = coords->getAt(i);
+        double xy[2] = {crd.x, crd.y};
+        buffer.append((const char *)xy, 16);
+    }
+    qint32 deleted=1;
+    buffer.append((const char *)&deleted, 4);
+    buffer.append((const char *)&raw, 4);
+}
 
-    std::ofstream output_file(filename.toLatin1(),ios_base::out | ios_base::binary | ios_base::trunc);
-    if ( !output_file.is_open())
-        return ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
+void FeatureConnector::appendPoint(QByteArray& buffer, const geos::geom::Point* point, qint32 raw ) const{
+    const geos::geom::Coordinate *crd = point->getCoordinate();
+    double xy[2] = {crd->x, crd->y};
+    buffer.append((const char *)xy, 16);
+    buffer.append((const char *)&raw, 4);
+}
+
+void FeatureConnector::collectGeometries(FeatureCoverage *fcov, IlwisTypes tp, std::vector<RawGeometry>& geometries){
     IFeatureCoverage cov;
     cov.set(fcov);
     FeatureIterator iter(cov);
     double raw = 1;
-    for_each(iter, iter.end(), [&](SPFeatureI feature){
-        if ( feature->geometry().get() != 0){
-            storePolygon(feature->geometry(), fcov,output_file,raw);
-            auto indexes = fcov->attributeDefinitions().indexes();
-            for(auto index : indexes) {
-                auto subfeature = feature[index];
-                if (!subfeature.get()) {
-                    continue;
-                }
-                storePolygon(subfeature->geometry(), fcov,output_file,raw);
+    auto indexes = fcov->attributeDefinitions().indexes();
+    geometries.reserve(fcov->featureCount(tp));
 
+    for_each(iter, iter.end(), [&](SPFeatureI feature){
+        if ( feature->geometry().get() == 0)
+            return true;
+        collectGeometry(feature->geometry(), fcov, tp, geometries, raw);
+        for(auto index : indexes) {
+            auto subfeature = feature[index];
+            if (!subfeature.get()) {
+                continue;
             }
+            collectGeometry(subfeature->geometry(), fcov, tp, geometries, raw);
+
         }
         return true;
     });
-
-    output_file.close();
-
-    return true;
 }
 
-void FeatureConnector::storePolygon(const UPGeometry& geom, const FeatureCoverage *fcov, std::ofstream& output_file, double& raw){
+void FeatureConnector::collectGeometry(const UPGeometry& geom, const FeatureCoverage *fcov, IlwisTypes tp, std::vector<RawGeometry>& geometries, double& raw){
+    if ( !geom)
+        return;
+    geos::geom::GeometryTypeId single = tp == itPOLYGON ? geos::geom::GEOS_POLYGON : (tp == itLINE ? geos::geom::GEOS_LINESTRING : geos::geom::GEOS_POINT);
+    geos::geom::GeometryTypeId multi = tp == itPOLYGON ? geos::geom::GEOS_MULTIPOLYGON : (tp == itLINE ? geos::geom::GEOS_MULTILINESTRING : geos::geom::GEOS_MULTIPOINT);
     geos::geom::GeometryTypeId geostype = geom->getGeometryTypeId();
-    if ( geostype == geos::geom::GEOS_POLYGON || geostype == geos::geom::GEOS_MULTIPOLYGON) {
-        const geos::geom::Geometry *polygons = geom.get();
-        if ( geostype == geos::geom::GEOS_POLYGON ){
-            const geos::geom::Polygon *polygon = dynamic_cast<const geos::geom::Polygon*>(polygons);
-            if ( !polygon){
-                ERROR2(ERR_NO_INITIALIZED_2, "polygon", fcov->name());
-                return;
-            }
-            writePolygon(polygon,output_file,raw);
-        } else {
-            int n = polygons->getNumGeometries();
-            for(int i = 0; i < n ; ++i){
-                const geos::geom::Polygon* polygon = dynamic_cast<const geos::geom::Polygon*>(polygons->getGeometryN(i));
-                if ( !polygon){
-                    ERROR2(ERR_NO_INITIALIZED_2, "polygon", fcov->name());
-                    return;
+    if ( geostype != single && geostype != multi)
+        return;
+
+    int n = geostype == single ? 1 : geom->getNumGeometries();
+    for(int i = 0; i < n ; ++i){
+        const geos::geom::Geometry *part = geostype == single ? geom.get() : geom->getGeometryN(i);
+        if ( !part || part->getGeometryTypeId() != single){
+            ERROR2(ERR_NO_INITIALIZED_2, tp == itPOLYGON ? "polygon" : (tp == itLINE ? "lines" : "points"), fcov->name());
+            return;
+        }
+        if ( tp == itLINE)
+            part->getEnvelopeInternal(); // envelopes are computed on first use; that must not happen in the writer threads
+        geometries.push_back({part, raw});
+    }
+    ++raw;
+}
+
+bool FeatureConnector::writeGeometries(std::ofstream& output_file, const std::vector<RawGeometry>& geometries, IlwisTypes tp) const{
+    // a batch of geometries is serialised in parallel, one buffer per thread; the buffers are written in order
+    // so the file is the same as when the geometries were written one by one
+    quint32 threads = std::max(1, QThread::idealThreadCount());
+    std::vector<QByteArray> buffers(threads);
+    const quint64 batchSize = threads * 1024;
+    // a reserved buffer keeps its capacity on resize(0), so the batches reuse the same storage
+    for(QByteArray& buffer : buffers)
+        buffer.reserve(1 << 20);
+    for(quint64 batchStart = 0; batchStart < geometries.size(); batchStart += batchSize) {
+        quint64 batchEnd = std::min((quint64)geometries.size(), batchStart + batchSize);
+        quint64 chunk = (batchEnd - batchStart + threads - 1) / threads;
+        std::vector<std::future<void>> futures;
+        for(quint32 t = 0; t < threads; ++t) {
+            quint64 start = batchStart + t * chunk;
+            quint64 end = std::min(batchEnd, start + chunk);
+            buffers[t].resize(0);
+            if ( start >= end)
+                continue;
+            futures.push_back(std::async(std::launch::async, [&, t, start, end]() {
+                QByteArray& buffer = buffers[t];
+                for(quint64 i = start; i < end; ++i) {
+                    const RawGeometry& item = geometries[i];
+                    if ( tp == itPOLYGON)
+                        appendPolygon(buffer, static_cast<const geos::geom::Polygon *>(item._geometry), item._raw);
+                    else if ( tp == itLINE)
+                        appendLine(buffer, static_cast<const geos::geom::LineString *>(item._geometry), item._raw);
+                    else
+                        appendPoint(buffer, static_cast<const geos::geom::Point *>(item._geometry), item._raw);
                 }
-                writePolygon(polygon,output_file,raw);
-            }
+            }));
         }
-
-        ++raw;
+        for(auto& future : futures)
+            future.get();
+        for(const QByteArray& buffer : buffers)
+            output_file.write(buffer.constData(), buffer.size());
     }
+    return output_file.good();
 }
 
-void FeatureConnector::writeLine(const geos::geom::LineString* line,std::ofstream& output_file,long raw ) {
-    if (!line)
-        return;
-    const geos::geom::Envelope *env = line->getEnvelopeInternal();
-    const std::vector<geos::geom::Coordinate>* coords = line->getCoordinatesRO()->toVector();
-    const geos::geom::Coordinate crdmin(env->getMinX(), env->getMinY());
-    const geos::geom::Coordinate crdmax(env->getMaxX(), env->getMaxY());
-    writeCoord(output_file, crdmin);
-    writeCoord(output_file, crdmax);
-    int noOfCoordsBytes = line->getNumPoints() * 16;
-    output_file.write((char *)&noOfCoordsBytes, 4);
-    for(const Coordinate& crd: *coords) {
-        writeCoord(output_file, geos::geom::Coordinate(crd));
-    }
-    long deleted=1;
-    output_file.write((char *)&deleted, 4);
-    output_file.write((char *)&raw, 4);
+bool FeatureConnector::storeBinaryDataPolygon(FeatureCoverage *fcov, const QString& baseName) {
+    QString filename = baseName + ".mpz#";
+
+    std::ofstream output_file(filename.toLatin1(),ios_base::out | ios_base::binary | ios_base::trunc);
+    if ( !output_file.is_open())
+        return ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
+
+    std::vector<RawGeometry> geometries;
+    collectGeometries(fcov, itPOLYGON, geometries);
+    bool ok = writeGeometries(output_file, geometries, itPOLYGON);
+
+    output_file.close();
+
+    return ok ? true : ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
 }
 
 bool FeatureConnector::storeBinaryDataLine(FeatureCoverage *fcov, const QString& baseName) {
@@ -570,59 +710,13 @@ bool FeatureConnector::storeBinaryDataLine(FeatureCoverage *fcov, const QString&
     memset(header, 0, 128);
     output_file.write(header,128);
 
-    IFeatureCoverage cov;
-    cov.set(fcov);
-    FeatureIterator iter(cov);
-    double raw = 1;
-
-    for_each(iter, iter.end(), [&](SPFeatureI feature){
-        storeSegment(feature->geometry(), fcov,output_file,raw);
-        auto indexes = fcov->attributeDefinitions().indexes();
-        for(auto index : indexes) {
-            auto subfeature = feature[index];
-            if (!subfeature.get()) {
-                continue;
-            }
-            storeSegment(subfeature->geometry(), fcov,output_file,raw);
-
-        }
-        return true;
-    });
+    std::vector<RawGeometry> geometries;
+    collectGeometries(fcov, itLINE, geometries);
+    bool ok = writeGeometries(output_file, geometries, itLINE);
 
     output_file.close();
 
-    return true;
-}
-
-void FeatureConnector::storeSegment(const UPGeometry& geom, const FeatureCoverage *fcov, std::ofstream& output_file, double& raw){
-    geos::geom::GeometryTypeId geostype = geom->getGeometryTypeId();
-    if ( geostype == geos::geom::GEOS_MULTILINESTRING || geos::geom::GEOS_LINESTRING) {
-
-        const geos::geom::Geometry *lines = geom.get();
-        if ( geostype == geos::geom::GEOS_LINESTRING ){
-            const geos::geom::LineString *line = dynamic_cast<const geos::geom::LineString*>(lines);
-            if ( !line){
-                ERROR2(ERR_NO_INITIALIZED_2, "lines", fcov->name());
-                return;
-            }
-            writeLine(line,output_file,raw);
-        } else {
-            int n = lines->getNumGeometries();
-            for(int i = 0; i < n ; ++i){
-                const geos::geom::LineString *line = dynamic_cast<const geos::geom::LineString*>(lines->getGeometryN(i));
-                if ( !line){
-                    ERROR2(ERR_NO_INITIALIZED_2, "lines", fcov->name());
-                    return;
-                }
-                writeLine(line,output_file,raw);
-            }
-        }
-        ++raw;
-    }
-}
-void FeatureConnector::writePoint(const geos::geom::Point* point,std::ofstream& output_file,long raw ) {
-    writeCoord(output_file, *(point->getCoordinate()));
-    output_file.write((char *)&raw, 4);
+    return ok ? true : ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
 }
 
 bool FeatureConnector::storeBinaryDataPoints(FeatureCoverage *fcov, const QString& baseName) {
@@ -635,55 +729,13 @@ bool FeatureConnector::storeBinaryDataPoints(FeatureCoverage *fcov, const QStrin
     memset(header, 0, 128);
     output_file.write(header,128);
 
-    IFeatureCoverage cov;
-    cov.set(fcov);
-    FeatureIterator iter(cov);
-    double raw = 1;
-
-    for_each(iter, iter.end(), [&](SPFeatureI feature){
-        storePoint(feature->geometry(), fcov,output_file,raw);
-        auto indexes = fcov->attributeDefinitions().indexes();
-        for(auto index : indexes) {
-            auto subfeature = feature[index];
-            if (!subfeature.get()) {
-                continue;
-            }
-            storePoint(subfeature->geometry(), fcov,output_file,raw);
-
-        }
-        return true;
-    });
+    std::vector<RawGeometry> geometries;
+    collectGeometries(fcov, itPOINT, geometries);
+    bool ok = writeGeometries(output_file, geometries, itPOINT);
 
     output_file.close();
 
-    return true;
-}
-
-void FeatureConnector::storePoint(const UPGeometry& geom, const FeatureCoverage *fcov, std::ofstream& output_file, double& raw){
-    geos::geom::GeometryTypeId geostype = geom->getGeometryTypeId();
-    if ( geostype == geos::geom::GEOS_MULTIPOINT ||geostype == geos::geom::GEOS_POINT) {
-
-        const geos::geom::Geometry *points = geom.get();
-        if ( geostype == geos::geom::GEOS_POINT ){
-            const geos::geom::Point *point = dynamic_cast<const geos::geom::Point*>(points);
-            if ( !point){
-                ERROR2(ERR_NO_INITIALIZED_2, "points", fcov->name());
-                return;
-            }
-            writePoint(point,output_file, raw);
-        } else {
-            int n = points->getNumGeometries();
-            for(int i = 0; i < n ; ++i){
-                const geos::geom::Point* point = dynamic_cast<const geos::geom::Point*>(points->getGeometryN(i));
-                if ( !point){
-                    ERROR2(ERR_NO_INITIALIZED_2, "points", fcov->name());
-                    return;
-                }
-                writePoint(point,output_file, raw);
-            }
-        }
-        ++raw;
-    }
+    return ok ? true : ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
 }
 
 bool FeatureConnector::storeBinaryData(FeatureCoverage *fcov, bool isMulti,IlwisTypes type) {
@@ -718,23 +770,6 @@ bool FeatureConnector::storeBinaryData(IlwisObject *obj) {
     return ok;
 }
 
-void FeatureConnector::writeCoords(std::ofstream& output_file, const std::vector<geos::geom::Coordinate>* coords, bool singleton) {
-    quint32 crdCount = coords->size();
-    if(!singleton) {
-        output_file.write((char *)&crdCount,4);
-    }
-    std::vector<double> crds(crdCount * 3);
-    quint32 count = 0;
-    for(const geos::geom::Coordinate& crd : *coords) {
-        crds[count] = crd.x;
-        crds[count+1] = crd.y;
-        crds[count+2] = 0;
-        count +=3;
-    }
-    output_file.write((char *)&crds[0], crdCount * 8 * 3);
-
-}
-
 void FeatureConnector::storeColumn(const QString& colName, const QString& domName, const QString& domInfo, const QString& storeType) {
     _odf->setKeyValue(colName, "Time", Time::now().toString());
     _odf->setKeyValue(colName, "Version", "3.1");
@@ -30,17 +30,30 @@ public:
 
     QString format() const;
 private:
+    // the segments of a 3.0 polygon map; the coordinates of segment i are _coords[_starts[i]] up to _coords[_starts[i+1]]
+    struct Topology {
+        std::vector<qint32> _forward;
+        std::vector<qint32> _backward;
+        std::vector<geos::geom::Coordinate> _coords;
+        std::vector<quint64> _starts;
+    };
+    // a single polygon, line or point and the raw value it is written with
+    struct RawGeometry {
+        const geos::geom::Geometry *_geometry;
+        double _raw;
+    };
+
     bool loadBinaryPoints(FeatureCoverage *fcoverage);
     bool loadBinarySegments(FeatureCoverage *fcoverage);
     bool loadBinaryPolygons(FeatureCoverage *fcoverage);
     bool loadBinaryPolygons30(FeatureCoverage *fcoverage, ITable &tbl);
     bool loadBinaryPolygons37(FeatureCoverage *fcoverage, ITable& tbl);
     //bool readRing(QDataStream &stream,boost::geometry::model::ring<Coordinate2d>& ring);
-    geos::geom::CoordinateArraySequence *readRing(QDataStream &stream);
-    bool getRings(Ilwis::FeatureCoverage *fcoverage, qint32 startIndex, const BinaryIlwis3Table &topTable, const BinaryIlwis3Table& polTable, std::vector<geos::geom::LinearRing *> *rings);
-    bool isForwardStartDirection(const BinaryIlwis3Table &topTable, qint32 colForward, qint32 colBackward, qint32 colCoords, long index);
+    geos::geom::CoordinateArraySequence *readRing(const char *&data, const char *end);
+    bool loadTopology(const BinaryIlwis3Table &topTable, Topology &topology) const;
+    bool getRings(qint32 startIndex, const Topology &topology, std::vector<std::vector<geos::geom::Coordinate> *> &rings) const;
+    bool isForwardStartDirection(const Topology &topology, long index) const;
 
-    void writeCoords(std::ofstream &output_file, const std::vector<geos::geom::Coordinate>* coords, bool singleton=false);
     bool storeMetaPolygon(FeatureCoverage *fcov, const QString &dataFile);
     bool storeMetaLine(FeatureCoverage *fcov, const QString &dataFile);
     bool storeMetaPoint(FeatureCoverage *fcov, const QString &filepath);
@@ -52,20 +65,17 @@ private:
 
     void storeColumn(const QString &colName, const QString &domName, const QString &domInfo, const QString &storeType);
 
-    void writeCoord(std::ofstream& output_file, const geos::geom::Coordinate& crd) {
-        double x = crd.x;
-        double y = crd.y;
-        output_file.write((char *)&x, 8);
-        output_file.write((char *)&y, 8);
-    }
-    void writeLine(const geos::geom::LineString *line, std::ofstream &output_file, long raw);
-    void writePolygon(const geos::geom::Polygon *polygon, std::ofstream &output_file, double raw);
-    void writePoint(const geos::geom::Point *point, std::ofstream &output_file, long raw);
+    void appendCoords(QByteArray &buffer, const geos::geom::CoordinateSequence *coords) const;
+    void appendLine(QByteArray &buffer, const geos::geom::LineString *line, qint32 raw) const;
+    void appendPolygon(QByteArray &buffer, const geos::geom::Polygon *polygon, double raw) const;
+    void appendPoint(QByteArray &buffer, const geos::geom::Point *point, qint32 raw) const;
     void addFeatures(map<quint32, vector<geos::geom::Geometry *> > &geometries, FeatureCoverage *fcoverage, const std::vector<double>& featureValues, IlwisTypes tp);
+    void addFeatures(QHash<quint32, vector<geos::geom::Geometry *> > &geometries, FeatureCoverage *fcoverage, IlwisTypes tp);
+    geos::geom::Geometry *createMultiGeometry(FeatureCoverage *fcoverage, const vector<geos::geom::Geometry *> &geometries, IlwisTypes tp) const;
     bool storeBinaryDataTable(IlwisObject *obj, IlwisTypes tp, const QString &baseName);
-    void storeSegment(const UPGeometry &geom, const FeatureCoverage *fcov, std::ofstream &output_file, double &raw);
-    void storePolygon(const UPGeometry &geom, const FeatureCoverage *fcov, std::ofstream &output_file, double &raw);
-    void storePoint(const UPGeometry &geom, const FeatureCoverage *fcov, std::ofstream &output_file, double &raw);
+    void collectGeometries(FeatureCoverage *fcov, IlwisTypes tp, std::vector<RawGeometry> &geometries);
+    void collectGeometry(const UPGeometry &geom, const FeatureCoverage *fcov, IlwisTypes tp, std::vector<RawGeometry> &geometries, double &raw);
+    bool writeGeometries(std::ofstream &output_file, const std::vector<RawGeometry> &geometries, IlwisTypes tp) const;
     quint32 countPolygons(FeatureCoverage *fcov);
 };
 }
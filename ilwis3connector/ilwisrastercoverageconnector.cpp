@@ -5,6 +5,11 @@
 #include <fstream>
 #include <iterator>
 #include <future>
+#include <QThread>
+#ifndef Q_OS_WIN
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 #include "kernel.h"
 #include "raster.h"
@@ -42,6 +47,7 @@ ConnectorInterface *RasterCoverageConnector::create(const Resource &resource, bo
 
 RasterCoverageConnector::RasterCoverageConnector(const Resource &resource, bool load, const IOOptions &options) : CoverageConnector(resource, load, options),_storesize(1)
 {
+    _writeThreads = std::max(1, QThread::idealThreadCount());
 }
 
 bool RasterCoverageConnector::loadMapList(IlwisObject *data,const IOOptions& options) {
@@ -70,32 +76,30 @@ bool RasterCoverageConnector::loadMapList(IlwisObject *data,const IOOptions& opt
     for(int i =0; i < sz.zsize(); ++i)
         bands[i] = i;
     gcoverage->stackDefinitionRef().setSubDefinition(IDomain("count"),bands);
-    for(int i = 0; i < z; ++i) {
-        QString file = _odf->value("MapList",QString("Map%1").arg(i));
-        //file = filename2FullPath(file);
-        file = _resource.container().toLocalFile()+ "/" + file;
-        if ( file != sUNDEF) {
-            ODF odf(new IniFile(file));
-            //QString dataFile = filename2FullPath(odf.value("MapStore","Data"));
-            QUrl url (QUrl::fromLocalFile(_resource.container().toLocalFile() + "/" + odf->value("MapStore","Data")));
-            _dataFiles.push_back(url);
-
-            DataDefinition def = determineDataDefintion(odf, options);
-            if ( !def.isValid()) {
-                return false;
-            }
-            gcoverage->setBandDefinition(i, def);
-
-        } else {
-            ERROR2(ERR_COULD_NOT_LOAD_2,"files","maplist");
-            --z;
-        }
-    }
 
     IniFile odf;
     if (!odf.setIniFile(QUrl(file).toLocalFile()))
         return ERROR2(ERR_COULD_NOT_LOAD_2,"files","maplist");
 
+    // the members of a map list nearly always share the domain of the first member; its definition is used for all
+    // bands and the odf of a member is only read when the data of that band is loaded
+    _sharedDomain = domainKey(odf);
+    _bandFiles.clear();
+    _dataFiles.assign(z, QUrl());
+    _bandResolved.assign(z, false);
+    for(int i = 0; i < z; ++i) {
+        QString file = _odf->value("MapList",QString("Map%1").arg(i));
+        if ( file == sUNDEF)
+            return ERROR2(ERR_COULD_NOT_LOAD_2,"files","maplist");
+        _bandFiles.push_back(_resource.container().toLocalFile()+ "/" + file);
+        gcoverage->setBandDefinition(i, mp->datadef());
+    }
+    bool lazy = !options.contains("lazybands") || options["lazybands"].toBool();
+    for(int i = 0; i < z && !lazy; ++i) {
+        if (!resolveBand(gcoverage, i, options))
+            return false;
+    }
+
     QString storeType = odf.value("MapStore","Type");
     setStoreType(storeType);
 
@@ -124,6 +128,29 @@ bool RasterCoverageConnector::loadMapList(IlwisObject *data,const IOOptions& opt
 
 }
 
+QString RasterCoverageConnector::domainKey(const IniFile &odf) const
+{
+    return odf.value("BaseMap","Domain") + "|" + odf.value("BaseMap","DomainInfo") + "|" + odf.value("BaseMap","Range");
+}
+
+bool RasterCoverageConnector::resolveBand(RasterCoverage *raster, quint32 band, const IOOptions &options)
+{
+    if ( band >= _bandResolved.size() || _bandResolved[band])
+        return true;
+
+    ODF odf(new IniFile(_bandFiles[band]));
+    _dataFiles[band] = QUrl::fromLocalFile(_resource.container().toLocalFile() + "/" + odf->value("MapStore","Data"));
+    if ( domainKey(*odf) != _sharedDomain) {
+        DataDefinition def = determineDataDefintion(odf, options);
+        if ( !def.isValid()) {
+            return false;
+        }
+        raster->setBandDefinition(band, def);
+    }
+    _bandResolved[band] = true;
+    return true;
+}
+
 void RasterCoverageConnector::setStoreType(const QString& storeType) {
     _storetype = itUINT8;
     if ( storeType == "Int") {
@@ -195,6 +222,7 @@ bool RasterCoverageConnector::loadMetaData(IlwisObject *data, const IOOptions &o
     if(!setDataType(data, options))
         return false;
     _dataFiles.clear();
+    _bandResolved.clear();
 
     bool isMapList  = inf.suffix().toLower() == "mpl";
 
@@ -338,6 +366,8 @@ bool RasterCoverageConnector::loadData(IlwisObject* data, const IOOptions &optio
     std::map<quint32, std::vector<quint32> > blocklimits = grid->calcBlockLimits(iooptions);
 
     for(const auto& layer : blocklimits){
+        if (!resolveBand(raster, layer.first, iooptions))
+            return false;
         QString  datafile = _dataFiles[layer.first].toLocalFile();
         if ( datafile.right(1) != "#") { // can happen, # is a special token in urls
             datafile += "#";
@@ -388,11 +418,22 @@ bool RasterCoverageConnector::storeBinaryData(IlwisObject *obj)
     if ( raster->size().zsize() > 1) // mpl doesnt have binary data
         return true;
 
+    bool ok = storeRaster(raster, obj->source(IlwisObject::cmOUTPUT).toLocalFile(), _writeThreads);
+    ITable attTable = raster->attributeTable();
+    if ( attTable.isValid() && attTable->isValid()) {
+         attTable->store({"storemode",IlwisObject::smBINARYDATA});
+    }
+    return ok;
+
+}
+
+bool RasterCoverageConnector::storeRaster(const IRasterCoverage &raster, const QString &output, quint32 threads) const
+{
     const IDomain dom = raster->datadef().domain<>();
     if (!dom.isValid())
         return ERROR2(ERR_NO_INITIALIZED_2, "Domain", raster->name());
 
-    QFileInfo inf(obj->source(IlwisObject::cmOUTPUT).toLocalFile());
+    QFileInfo inf(output);
     QString filename;
 
     filename = inf.absolutePath() + "/" + QString(inf.baseName()).replace(QRegExp("[/ .'\"]"),"_") + ".mp#";
@@ -400,49 +441,70 @@ bool RasterCoverageConnector::storeBinaryData(IlwisObject *obj)
     Size<> sz = raster->size();
     bool ok = false;
     if ( dom->ilwisType() == itNUMERICDOMAIN) {
-        calcStatics(obj, NumericStatistics::pBASIC);
+        calcStatics(raster, NumericStatistics::pBASIC);
         const NumericStatistics& stats = raster->statistics();
         RawConverter conv(stats[NumericStatistics::pMIN], stats[NumericStatistics::pMAX],pow(10, - stats.significantDigits()));
 
-
-        std::ofstream output_file(filename.toLatin1(),ios_base::out | ios_base::binary | ios_base::trunc);
-        if ( !output_file.is_open())
-            return ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
-
         if ( conv.storeType() == itUINT8) {
-            ok = save<quint8>(output_file,conv.scale() == 1 ? RawConverter() : conv, raster,sz);
+            ok = save<quint8>(filename,conv.scale() == 1 ? RawConverter() : conv, raster,sz, threads);
         } else if ( conv.storeType() == itINT16) {
-            ok = save<qint16>(output_file,conv, raster,sz);
+            ok = save<qint16>(filename,conv, raster,sz, threads);
         } else if ( conv.storeType() == itINT32) {
-            save<qint32>(output_file,conv, raster,sz);
+            ok = save<qint32>(filename,conv, raster,sz, threads);
         } else {
-            ok = save<double>(output_file,conv, raster,sz);
+            ok = save<double>(filename,conv, raster,sz, threads);
         }
-        output_file.close();
 
     } else if ( dom->ilwisType() == itITEMDOMAIN ){
         if ( hasType(dom->valueType(), itTHEMATICITEM | itNAMEDITEM | itNUMERICITEM)) {
-            std::ofstream output_file(filename.toLatin1(),ios_base::out | ios_base::binary | ios_base::trunc);
-            if ( !output_file.is_open()){
-                return ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
-            }
-
             if( hasType(dom->valueType(), itTHEMATICITEM | itNUMERICITEM)){
                 RawConverter conv(dom->valueType() == itTHEMATICITEM ? "class" : "group");
-                ok = save<quint8>(output_file,conv, raster,sz);
+                ok = save<quint8>(filename,conv, raster,sz, threads);
             }
             else{
                 RawConverter conv("ident");
-                ok = save<quint16>(output_file,conv, raster,sz);
+                ok = save<quint16>(filename,conv, raster,sz, threads);
             }
         }
     }
-    ITable attTable = raster->attributeTable();
-    if ( attTable.isValid() && attTable->isValid()) {
-         attTable->store({"storemode",IlwisObject::smBINARYDATA});
-    }
     return ok;
+}
+
+bool RasterCoverageConnector::blockValues(UPGrid &grid, quint32 block, std::vector<double> &values) const
+{
+    quint32 noItems = grid->blockSize(block);
+    if ( noItems == iUNDEF)
+        return false;
+    grid->value(block, 0); // brings the block into memory if it was not loaded or was swapped out
+    const double *data = (const double *)grid->blockAsMemory(block, true);
+    if ( data == 0)
+        return false;
+    // copied right away; loading later blocks may swap this one out again
+    values.assign(data, data + noItems);
+    return true;
+}
 
+bool RasterCoverageConnector::writeAt(QFile &file, qint64 offset, const char *data, qint64 size, std::mutex& fileMutex) const
+{
+#ifdef Q_OS_WIN
+    std::lock_guard<std::mutex> lock(fileMutex);
+    return file.seek(offset) && file.write(data, size) == size;
+#else
+    Q_UNUSED(fileMutex);
+    int fd = file.handle();
+    while( size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, offset);
+        if ( written < 0) {
+            if ( errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+#endif
 }
 
 QString RasterCoverageConnector::format() const
@@ -452,6 +514,10 @@ QString RasterCoverageConnector::format() const
 
 void RasterCoverageConnector::calcStatics(const IlwisObject *obj, NumericStatistics::PropertySets set) const {
     IRasterCoverage raster = mastercatalog()->get(obj->id());
+    calcStatics(raster, set);
+}
+
+void RasterCoverageConnector::calcStatics(const IRasterCoverage &raster, NumericStatistics::PropertySets set) const {
     if ( !raster->statistics().isValid()) {
         PixelIterator iter(raster,BoundingBox(raster->size()));
         raster->statistics().calculate(iter, iter.end(),set);
@@ -475,6 +541,7 @@ bool RasterCoverageConnector::storeMetaDataMapList(IlwisObject *obj) {
     _odf->setKeyValue("MapList","Size",QString("%1 %2").arg(sz.ysize()).arg(sz.xsize()));
     _odf->setKeyValue("MapList","Maps",QString::number(sz.zsize()));
 
+    std::vector<IRasterCoverage> members;
     for(int i = 0; i < sz.zsize(); ++i) {
         QString mapName = QString("%1_band_%2").arg(obj->name()).arg(i);
         mapName = mapName.replace(QRegExp("[/ .'\"]"),"_");
@@ -490,11 +557,35 @@ bool RasterCoverageConnector::storeMetaDataMapList(IlwisObject *obj) {
         QString path = _odf->file().left(index);
         QUrl url =  path + "/" + mapName;
         gcMap->connectTo(url, "map", "ilwis3", Ilwis::IlwisObject::cmOUTPUT);
-        gcMap->store({"storemode",IlwisObject::smBINARYDATA | IlwisObject::smMETADATA});
+        gcMap->store({"storemode",IlwisObject::smMETADATA});
+        members.push_back(gcMap);
+    }
+
+    // the metadata of the members share files (e.g. the georeference) and is written above one member at a time.
+    // The members are resolved objects, so the workers only convert and write their .mp# files, each with a single thread
+    std::vector<QString> outputs;
+    for(const IRasterCoverage& member : members)
+        outputs.push_back(member->source(IlwisObject::cmOUTPUT).toLocalFile());
+    quint32 threads = std::max(1, QThread::idealThreadCount());
+    for(quint32 start = 0; start < members.size(); start += threads) {
+        std::vector<std::future<bool>> futures;
+        for(quint32 i = start; i < std::min((quint32)members.size(), start + threads); ++i) {
+            futures.push_back(std::async(std::launch::async, [this, &members, &outputs, i]() {
+                return storeRaster(members[i], outputs[i], 1);
+            }));
+        }
+        for(auto& future : futures)
+            ok &= future.get();
+    }
+    for(const IRasterCoverage& member : members) {
+        ITable attTable = member->attributeTable();
+        if ( attTable.isValid() && attTable->isValid()) {
+             attTable->store({"storemode",IlwisObject::smBINARYDATA});
+        }
     }
 
     _odf->store("mpl",source().toLocalFile());
-    return true;
+    return ok;
 }
 
 QString RasterCoverageConnector::getGrfName(const IRasterCoverage& raster) {
@@ -1,6 +1,11 @@
 #ifndef GRIDCOVERAGECONNECTOR_H
 #define GRIDCOVERAGECONNECTOR_H
 
+#include <deque>
+#include <future>
+#include <mutex>
+#include <QFile>
+
 namespace Ilwis {
 class BaseGrid;
 
@@ -28,31 +33,69 @@ private:
     double value(char *block, int index) const;
     void setStoreType(const QString &storeType);
     bool loadMapList(IlwisObject *data, const Ilwis::IOOptions &options);
+    bool resolveBand(RasterCoverage *raster, quint32 band, const IOOptions &options);
+    QString domainKey(const IniFile &odf) const;
     bool storeMetaDataMapList(Ilwis::IlwisObject *obj);
     QString getGrfName(const IRasterCoverage &raster);
     bool setDataType(IlwisObject *data, const Ilwis::IOOptions &options);
     void loadBlock(UPGrid &grid, QFile &file, quint32 blockIndex, quint32 fileBlock);
 
-    template<typename T> bool save(std::ofstream& output_file,const RawConverter& conv, const IRasterCoverage& raster, const Size<>& sz) const{
-        //TODO optimize this
-        PixelIterator pixiter(raster, BoundingBox(sz));
-        int  i=0;
-        T c = 0;
-        const char *ptr = reinterpret_cast<const char*>(&c);
-        //std::ofstream dum("d:/dummyout.txt",ios_base::out | ios_base::trunc);
-        for_each(pixiter, pixiter.end(), [&](double& v){
-            c = conv.real2raw(v);
-             ++i;
-            output_file.write(ptr, sizeof(T));
-            //dum << v << " ";
-       });
-        return true;
+    bool storeRaster(const IRasterCoverage &raster, const QString &output, quint32 threads) const;
+    void calcStatics(const IRasterCoverage &raster, NumericStatistics::PropertySets set) const;
+    bool blockValues(UPGrid &grid, quint32 block, std::vector<double> &values) const;
+    bool writeAt(QFile &file, qint64 offset, const char *data, qint64 size, std::mutex &fileMutex) const;
+
+    template<typename T> bool save(const QString& filename,const RawConverter& conv, const IRasterCoverage& raster, const Size<>& sz, quint32 threads) const{
+        QFile file(filename);
+        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered) || !file.resize((qint64)sz.xsize() * sz.ysize() * sizeof(T)))
+            return ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
+
+        // the grid blocks are taken in order on this thread, so the grid is only used by one thread. Converting a block to
+        // the raw type and writing it at its offset in the file is left to a worker; at most 'threads' blocks are underway
+        UPGrid& grid = raster->gridRef();
+        std::mutex fileMutex;
+        auto writeBlock = [this, &file, &conv, &fileMutex](qint64 offset, std::vector<double> values) {
+            std::vector<T> raws(values.size());
+            for(quint64 i = 0; i < values.size(); ++i)
+                raws[i] = conv.real2raw(values[i]);
+            return writeAt(file, offset, (const char *)raws.data(), raws.size() * sizeof(T), fileMutex);
+        };
+        std::deque<std::future<bool>> pending;
+        bool ok = true;
+        qint64 offset = 0;
+        for(quint32 block = 0; block < grid->blocksPerBand() && ok; ++block) {
+            std::vector<double> values;
+            if ( !blockValues(grid, block, values)) {
+                ok = false;
+                break;
+            }
+            qint64 blockOffset = offset;
+            offset += (qint64)values.size() * sizeof(T);
+            if ( threads <= 1) {
+                ok = writeBlock(blockOffset, std::move(values));
+                continue;
+            }
+            if ( pending.size() >= threads) {
+                ok = pending.front().get();
+                pending.pop_front();
+            }
+            pending.push_back(std::async(std::launch::async, writeBlock, blockOffset, std::move(values)));
+        }
+        for(auto& future : pending)
+            ok = future.get() && ok;
+        file.close();
+
+        return ok ? true : ERROR1(ERR_COULD_NOT_OPEN_WRITING_1,filename);
     }
 
     vector<QUrl> _dataFiles;
+    QStringList _bandFiles; // odfs of the members of a map list
+    std::vector<bool> _bandResolved; // a member's odf has been read and its band definition checked
+    QString _sharedDomain;
     int _storesize;
     IlwisTypes _storetype;
     IlwisTypes _dataType;
+    quint32 _writeThreads;
 };
 }
 }
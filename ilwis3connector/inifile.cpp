@@ -1,7 +1,10 @@
 #include  <stdio.h>
 #include  <stdlib.h>
+#include <list>
+#include <mutex>
 #include <QTextStream>
 #include <QRegExp>
+#include <QDateTime>
 #include "catalog.h"
 #include "kernel.h"
 #include "connectorinterface.h"
@@ -14,6 +17,19 @@
 
 using namespace Ilwis;
 
+namespace {
+// parsed odfs shared by all IniFile instances; a catalog scan reads the same .dom, .grf and .csy over and over
+struct CachedIni {
+    QDateTime _modified;
+    qint64 _size;
+    Sections _sections;
+};
+const quint32 MAX_CACHED_INIS = 2048;
+std::map<QString, CachedIni> cachedInis;
+std::list<QString> cacheOrder; // oldest first
+std::mutex cacheMutex;
+}
+
 IniFile::IniFile()
 {
 }
@@ -140,6 +156,11 @@ bool IniFile::load()
     if (!_filename.exists())
         return false;
 
+    QFileInfo current(_filename.absoluteFilePath()); // _filename may have cached an older state of the file
+    if ( cachedSections(current, _sections))
+        return true;
+    bool fresh = _sections.empty();
+
     QFile txtfile(_filename.absoluteFilePath());
     if (!txtfile.open(QIODevice::ReadOnly | QIODevice::Text)){
         return ERROR1(ERR_COULD_NOT_OPEN_READING_1, _filename.fileName());
@@ -205,9 +226,58 @@ bool IniFile::load()
              break;
          }
      }
+     if ( fresh)
+         cacheSections(current, _sections);
      return true;
 }
 
+bool IniFile::cachedSections(const QFileInfo &file, Sections &sections)
+{
+    QString path = file.canonicalFilePath();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto iter = cachedInis.find(path);
+    if ( iter == cachedInis.end())
+        return false;
+    const CachedIni& cached = iter->second;
+    if ( cached._modified != file.lastModified() || cached._size != file.size()) {
+        cachedInis.erase(iter);
+        cacheOrder.remove(path);
+        return false;
+    }
+    if ( sections.empty())
+        sections = cached._sections;
+    else {
+        for(const auto& section : cached._sections)
+            for(const auto& entry : section.second)
+                sections[section.first][entry.first] = entry.second;
+    }
+    return true;
+}
+
+void IniFile::cacheSections(const QFileInfo &file, const Sections &sections)
+{
+    QString path = file.canonicalFilePath();
+    if ( path == "")
+        return;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if ( cachedInis.find(path) == cachedInis.end()) {
+        cacheOrder.push_back(path);
+        if ( cacheOrder.size() > MAX_CACHED_INIS) {
+            cachedInis.erase(cacheOrder.front());
+            cacheOrder.pop_front();
+        }
+    }
+    cachedInis[path] = {file.lastModified(), file.size(), sections};
+}
+
+void IniFile::uncache(const QString &path)
+{
+    QString canonical = QFileInfo(path).canonicalFilePath();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if ( cachedInis.erase(canonical) > 0)
+        cacheOrder.remove(canonical);
+}
+
 void IniFile::store(const QString& ext, const QFileInfo& file )
 {
     QString path = file.absoluteFilePath();
@@ -245,5 +315,6 @@ void IniFile::store(const QString& ext, const QFileInfo& file )
     }
     text.flush();
     fileIni.close();
+    uncache(path); // the modification time may not have changed within the resolution of the file system
 
 }
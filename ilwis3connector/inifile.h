@@ -43,6 +43,10 @@ private:
 
     bool load();
 
+    static bool cachedSections(const QFileInfo &file, Sections &sections);
+    static void cacheSections(const QFileInfo &file, const Sections &sections);
+    static void uncache(const QString &path);
+
     void setValue(const QString &section, const QString &key, const QString &value);
 };
 
@@ -30,9 +30,6 @@ ODFItem::ODFItem(const QFileInfo &file) : Resource(QUrl::fromLocalFile(file.abso
     _file = file;
     name(_file.fileName(), false);
     addContainer(QUrl::fromLocalFile(_file.canonicalPath()));
-    IlwisTypes csytp, domtp, grftp;
-    csytp = domtp = grftp = itUNKNOWN;
-
     setDescription( _odf.value("Ilwis", "Description"));
 
     _ilwtype = Ilwis3Connector::ilwisType(_file.absoluteFilePath());
@@ -41,10 +38,15 @@ ODFItem::ODFItem(const QFileInfo &file) : Resource(QUrl::fromLocalFile(file.abso
     _grfname = findGrfName();
     _datumName = findDatumName();
 
+    // only what the odf files tell; the master catalog is consulted later in resolveTypes
+    _csyType = findCsyType(file.absoluteFilePath(), _lookupCsy);
+    _domType = findDomainType(file.absoluteFilePath(), _lookupDomain);
+}
 
-    csytp = findCsyType(file.absoluteFilePath());
-    domtp = findDomainType(file.absoluteFilePath());
-
+void ODFItem::resolveTypes()
+{
+    IlwisTypes csytp = catalogType(_csyname, itCOORDSYSTEM, _lookupCsy, _csyType);
+    IlwisTypes domtp = catalogType(_domname, itDOMAIN, _lookupDomain, _domType);
 
     if ( csytp != itUNKNOWN && _ilwtype == itCOORDSYSTEM)
         _ilwtype = csytp;
@@ -71,6 +73,52 @@ ODFItem::ODFItem(const QFileInfo &file) : Resource(QUrl::fromLocalFile(file.abso
     _dimensions = findDimensions();
 }
 
+IlwisTypes ODFItem::catalogType(const QString &name, IlwisTypes type, bool lookup, IlwisTypes fileType) const
+{
+    // an object known to the master catalog (e.g. a system object) determines the type, otherwise the file does
+    if ( lookup) {
+        Resource resource = mastercatalog()->name2Resource(name, type);
+        if ( resource.isValid())
+            return resource.ilwisType();
+    }
+    return fileType;
+}
+
+ODFItem::ODFItem(const QFileInfo &file, QDataStream &stream) : Resource(QUrl::fromLocalFile(file.absoluteFilePath()),itANY), _projectionName(sUNDEF)
+{
+    // the properties were found by an earlier scan and stored in the folder index; the odf itself is not read
+    _file = file;
+    name(_file.fileName(), false);
+    addContainer(QUrl::fromLocalFile(_file.canonicalPath()));
+
+    QString description;
+    quint64 ilwtype, extendedType, size;
+    stream >> ilwtype >> extendedType >> size >> _dimensions >> description;
+    stream >> _csyname >> _domname >> _grfname >> _datumName >> _projectionName;
+    _ilwtype = ilwtype;
+    _extendedType = extendedType;
+    _size = size;
+    setDescription(description);
+}
+
+QString ODFItem::reference(const QString &path) const
+{
+    // a file that does not exist (yet) is recorded as well; creating it changes the item
+    QFileInfo inf(path);
+    _references[inf.absoluteFilePath()] = inf.exists() ? inf.lastModified().toMSecsSinceEpoch() : -1;
+    return path;
+}
+
+QMap<QString, qint64> ODFItem::references() const
+{
+    return _references;
+}
+
+void ODFItem::storeIndex(QDataStream &stream) const
+{
+    stream << (quint64)_ilwtype << (quint64)_extendedType << (quint64)_size << _dimensions << description();
+    stream << _csyname << _domname << _grfname << _datumName << _projectionName;
+}
 
 bool ODFItem::resolveNames(const QHash<QString, quint64> &names)
 {
@@ -198,7 +246,7 @@ QString ODFItem::findDomainName(const QString& path) const
             if ( rasmap.indexOf(".mpr") == -1)
                 rasmap += ".mpr";
             IniFile ini;
-            ini.setIniFile(rasmap);
+            ini.setIniFile(reference(rasmap));
             name = ini.value("BaseMap","Domain");
         }
     }
@@ -209,8 +257,9 @@ QString ODFItem::findDomainName(const QString& path) const
     return cleanName(name);
 }
 
-IlwisTypes ODFItem::findDomainType(const QString& path) const
+IlwisTypes ODFItem::findDomainType(const QString& path, bool& lookup) const
 {
+    lookup = false;
     quint64 validTypes = itTABLE | itCOVERAGE | itDOMAIN;
     if ( (_ilwtype & validTypes) == 0)
         return itUNKNOWN;
@@ -229,13 +278,10 @@ IlwisTypes ODFItem::findDomainType(const QString& path) const
     if ( _domname == "color.dom")
         return itCOLORDOMAIN;
 
-    //Resource resource = mastercatalog()->name2Resource(stripExtension(_domname),itDOMAIN);
-    Resource resource = mastercatalog()->name2Resource(_domname,itDOMAIN);
-    if ( resource.isValid())
-        return resource.ilwisType();
+    lookup = true;
     IniFile dm;
     QString localpath = container().toLocalFile() + "/" + _domname;
-    if(!dm.setIniFile(localpath))
+    if(!dm.setIniFile(reference(localpath)))
         return itUNKNOWN;
 
     QString type =  dm.value("Domain", "Type");
@@ -273,7 +319,7 @@ QString ODFItem::findCsyName(const QString& path) const
                      QString grfpath = container().toLocalFile() + "/" + grf;
                      if ( grfpath != "none.grf"){
                         IniFile ini;
-                        ini.setIniFile(grfpath);
+                        ini.setIniFile(reference(grfpath));
                         name = ini.value("GeoRef","CoordSystem");
                      }else {
                          name = "unknown.csy";
@@ -290,8 +336,9 @@ QString ODFItem::findCsyName(const QString& path) const
     return cleanName(name);
 }
 
-IlwisTypes ODFItem::findCsyType(const QString& path) const
+IlwisTypes ODFItem::findCsyType(const QString& path, bool& lookup) const
 {
+    lookup = false;
     quint64 validTypes = itGEOREF | itCOORDSYSTEM | itCOVERAGE;
     if ( (_ilwtype & validTypes) == 0)
         return itUNKNOWN;
@@ -299,10 +346,7 @@ IlwisTypes ODFItem::findCsyType(const QString& path) const
     if ( _csyname == "")
         return itUNKNOWN;
 
-    //Resource resource = mastercatalog()->name2Resource(stripExtension(_csyname),itCOORDSYSTEM);
-    Resource resource = mastercatalog()->name2Resource(_csyname,itCOORDSYSTEM);
-    if ( resource.isValid())
-        return resource.ilwisType();
+    lookup = true;
     IniFile csy;
     if ( _csyname == "latlonwgs84.csy")
         return itCONVENTIONALCOORDSYSTEM;
@@ -320,14 +364,14 @@ IlwisTypes ODFItem::findCsyType(const QString& path) const
                 grf = container().toLocalFile()+ "/" + grf;
             }
             IniFile ini;
-            ini.setIniFile(grf);
+            ini.setIniFile(reference(grf));
             csyname = ini.value("GeoRef","CoordSystem");
             QFile file(csyname);
             if ( !file.exists()){
                 csyname = csyname.remove("\'");
                 csyname = container().toLocalFile() + "/" + csyname;
             }
-            csy.setIniFile(csyname);
+            csy.setIniFile(reference(csyname));
 
         }
     } else {
@@ -340,7 +384,7 @@ IlwisTypes ODFItem::findCsyType(const QString& path) const
             path = inf.absoluteFilePath();
         }
 
-        if(!csy.setIniFile(path)){
+        if(!csy.setIniFile(reference(path))){
             return itUNKNOWN;
         }
     }
@@ -421,7 +465,7 @@ quint64 ODFItem::partSize(const QUrl& file, const QString& section, const QStrin
         }
 
     }
-    QFileInfo inf(part.absoluteFilePath());
+    QFileInfo inf(reference(part.absoluteFilePath()));
     return inf.size();
 
 }
@@ -7,7 +7,22 @@ class ODFItem : public Resource
 {
 public:
     ODFItem(const QFileInfo& file);
+    ODFItem(const QFileInfo& file, QDataStream& stream);
+    /*!
+     \brief completes the types, size and dimensions of a newly parsed item
+
+     Parsing the odf only reads files and may happen on any thread; this step looks names up in the
+     mastercatalog and must be done on the thread that scans the catalog, before resolveNames.
+    */
+    void resolveTypes();
     bool resolveNames(const QHash<QString, quint64>& names);
+    void storeIndex(QDataStream& stream) const;
+    /*!
+     \brief the other files read while parsing (domains, georeferences, coordinate systems, data files)
+
+     \return the absolute paths with their modification time (msecs since epoch) at parse time, -1 for a missing file
+    */
+    QMap<QString, qint64> references() const;
 
 
     // bool isSystemObject(const QString &name) const;
@@ -28,9 +43,10 @@ private:
     bool setFileId(const QHash<QString, quint64> &names, const QString &unboundName, quint64 &fileid) const;
 
     QString findDomainName(const QString &path) const;
-    IlwisTypes findDomainType(const QString &path) const;
+    IlwisTypes findDomainType(const QString &path, bool &lookup) const;
     QString findCsyName(const QString &path) const;
-    IlwisTypes findCsyType(const QString &path) const;
+    IlwisTypes findCsyType(const QString &path, bool &lookup) const;
+    IlwisTypes catalogType(const QString &name, IlwisTypes type, bool lookup, IlwisTypes fileType) const;
     QString findGrfName() const;
     QString findDatumName() const;
     QString findProjectionName() const;
@@ -41,6 +57,7 @@ private:
     QString stripExtension(const QString &name) const;
     static bool isSystemObject(const QString &name);
     QString cleanName(const QString&) const;
+    QString reference(const QString& path) const;
 
     IniFile _odf;
     QFileInfo _file;
@@ -49,6 +66,11 @@ private:
     QString _csyname;
     QString _datumName;
     QString _projectionName;
+    IlwisTypes _csyType = itUNKNOWN;
+    IlwisTypes _domType = itUNKNOWN;
+    bool _lookupCsy = false;
+    bool _lookupDomain = false;
+    mutable QMap<QString, qint64> _references;
 
     const static QString systemObjectNames;
 
@@ -142,7 +142,7 @@ bool TableConnector::loadData(IlwisObject* data , const IOOptions &) {
     Locker<> lock(_mutex);
 
     Ilwis3::BinaryIlwis3Table tbl ;
-    if (!tbl.load(_odf)) // no table found?
+    if (!tbl.map(_odf)) // no table found?
         return false;
     Table *table = static_cast<Table *>(data);
 
@@ -150,6 +150,7 @@ bool TableConnector::loadData(IlwisObject* data , const IOOptions &) {
         return false;
     table->dataLoaded(true); //  to prevent any succesfull calls of iniltload, we are loading here so no extra call needed
 
+    // columns are read as a whole from the mapped data file; the table itself only accepts variants
     int colindex = 0;
     while( colindex < tbl.columns()) {
         QString colName = tbl.columnName(colindex);
@@ -158,19 +159,19 @@ bool TableConnector::loadData(IlwisObject* data , const IOOptions &) {
             std::vector<QVariant> varlist(tbl.rows());
             RawConverter conv = _converters[colName];
             IlwisTypes valueType = col.datadef().domain<>()->valueType();
-            for(quint32 j = 0; j < tbl.rows(); ++j){
-                if ( (valueType >= itINT8 && valueType <= itDOUBLE) || ((valueType & itDOMAINITEM) != 0)) {
-                    double value;
-                    if (tbl.get(j,colindex,value)) {
-                        double v = conv.scale() == 0 ? value : conv.raw2real(value);
-                        varlist[j] =  v;
-                    }
-                } else if (valueType == itSTRING ) {
-                    QString value;
-                    if (tbl.get(j,colindex,value)) {
-                        varlist[j] = value;
+            if ( (valueType >= itINT8 && valueType <= itDOUBLE) || ((valueType & itDOMAINITEM) != 0)) {
+                std::vector<double> values;
+                if ( tbl.column(colindex, values)) {
+                    if ( conv.scale() != 0) {
+                        for(double& value : values)
+                            value = conv.raw2real(value);
                     }
+                    std::copy(values.begin(), values.end(), varlist.begin());
                 }
+            } else if (valueType == itSTRING ) {
+                std::vector<QString> values;
+                if ( tbl.column(colindex, values))
+                    std::copy(values.begin(), values.end(), varlist.begin());
             }
             table->column(colName,varlist);
         }
@@ -198,6 +199,8 @@ bool TableConnector::storeBinaryData(IlwisObject *obj)
         ilw3tbl.addStoreDefinition(def.datadef());
     }
     quint32 reccount = _selected.size() > 0 ? _selected.size() :  tbl->recordCount();
+    QByteArray buffer;
+    buffer.reserve(BinaryIlwis3Table::OUTPUT_BUFFER_SIZE);
     for(int y=0; y < reccount; ++y) {
         std::vector<QVariant> rec;
         if ( _selected.size() > 0 ){
@@ -207,9 +210,14 @@ bool TableConnector::storeBinaryData(IlwisObject *obj)
             rec = tbl->record(y);
         }
 
-        ilw3tbl.storeRecord(output_file, rec, skip);
+        ilw3tbl.storeRecord(buffer, rec, skip);
+        if ( buffer.size() >= BinaryIlwis3Table::OUTPUT_BUFFER_SIZE) {
+            output_file.write(buffer.constData(), buffer.size());
+            buffer.resize(0);
+        }
 
     }
+    output_file.write(buffer.constData(), buffer.size());
 
     output_file.close();
     return true;
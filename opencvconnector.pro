@@ -51,7 +51,9 @@ HEADERS += \
     opencvconnector/gaussianblurfilter.h \
     opencvconnector/medianblurfilter.h \
     opencvconnector/comparehistograms.h \
-    opencvconnector/histogramequalization.h
+    opencvconnector/histogramequalization.h \
+    opencvconnector/filterchain.h \
+    opencvconnector/histogramengine.h
 
 SOURCES += \
     opencvconnector/opencvmodule.cpp \
@@ -68,6 +70,8 @@ SOURCES += \
     opencvconnector/gaussianblurfilter.cpp \
     opencvconnector/medianblurfilter.cpp \
     opencvconnector/comparehistograms.cpp \
-    opencvconnector/histogramequalization.cpp
+    opencvconnector/histogramequalization.cpp \
+    opencvconnector/filterchain.cpp \
+    opencvconnector/histogramengine.cpp
 
 
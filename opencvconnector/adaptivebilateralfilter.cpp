@@ -29,6 +29,11 @@ bool AdaptiveBilateralFilter::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRa
     return true;
 }
 
+cv::Size AdaptiveBilateralFilter::halo() const
+{
+    return OpenCVHelper::kernelHalo(_kernelSize);
+}
+
 Ilwis::OperationImplementation *AdaptiveBilateralFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new AdaptiveBilateralFilter(metaid,expr);
@@ -39,17 +44,8 @@ Ilwis::OperationImplementation::State AdaptiveBilateralFilter::prepare(Execution
     try{
         createInputOutputRasters(itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-        OperationHelper::check([&] ()->bool { return hasType(_inputRaster->datadef().domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
-            {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source image or floating-point, 1-channel or color" } );
-
-
-        int ksizex = _expression.input<int>(1);
-        int ksizey = _expression.input<int>(2);
-
-        _kernelSize = cv::Size(ksizex, ksizey);
-        _sigmaSpace = _expression.input<double>(3);
-
-        _maxSigmaColor = _expression.parameterCount() == 4 ? 20 : _expression.input<int>(4);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -59,6 +55,23 @@ Ilwis::OperationImplementation::State AdaptiveBilateralFilter::prepare(Execution
     return sPREPAREFAILED;
 }
 
+bool AdaptiveBilateralFilter::prepareFilter(const DataDefinition &input, DataDefinition &)
+{
+    OperationHelper::check([&] ()->bool { return hasType(input.domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
+        {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source image or floating-point, 1-channel or color" } );
+
+
+    int ksizex = _expression.input<int>(1);
+    int ksizey = _expression.input<int>(2);
+
+    _kernelSize = cv::Size(ksizex, ksizey);
+    _sigmaSpace = _expression.input<double>(3);
+
+    _maxSigmaColor = _expression.parameterCount() == 4 ? 20 : _expression.input<int>(4);
+
+    return true;
+}
+
 quint64 AdaptiveBilateralFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/adaptivebilateralfilter"},"opencv");
@@ -26,6 +26,8 @@ private:
     cv::Size _kernelSize;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &);
+    cv::Size halo() const;
 
 
 };
@@ -28,6 +28,13 @@ bool BilateralFilter::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) co
     return true;
 }
 
+cv::Size BilateralFilter::halo() const
+{
+    int radius = _pixneighborhood > 0 ? _pixneighborhood / 2 : cvRound(_sigmaSpace * 1.5);
+
+    return cv::Size(radius, radius);
+}
+
 Ilwis::OperationImplementation *BilateralFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new BilateralFilter(metaid,expr);
@@ -38,12 +45,8 @@ Ilwis::OperationImplementation::State BilateralFilter::prepare(ExecutionContext
     try{
         createInputOutputRasters(itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-        OperationHelper::check([&] ()->bool { return hasType(_inputRaster->datadef().domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
-            {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source image or floating-point, 1-channel or color" } );
-
-        _pixneighborhood = _expression.input<double>(1);
-        _sigmaColor = _expression.input<double>(2);
-        _sigmaSpace = _expression.input<double>(3);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -53,6 +56,18 @@ Ilwis::OperationImplementation::State BilateralFilter::prepare(ExecutionContext
     return sPREPAREFAILED;
 }
 
+bool BilateralFilter::prepareFilter(const DataDefinition &input, DataDefinition &)
+{
+    OperationHelper::check([&] ()->bool { return hasType(input.domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
+        {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source image or floating-point, 1-channel or color" } );
+
+    _pixneighborhood = _expression.input<double>(1);
+    _sigmaColor = _expression.input<double>(2);
+    _sigmaSpace = _expression.input<double>(3);
+
+    return true;
+}
+
 quint64 BilateralFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/bilateralfilter"},"opencv");
@@ -14,6 +14,7 @@ public:
     BilateralFilter(quint64 metaid, const Ilwis::OperationExpression &expr);
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &);
     static Ilwis::OperationImplementation *create(quint64 metaid,const Ilwis::OperationExpression& expr);
     Ilwis::OperationImplementation::State prepare(ExecutionContext *ctx, const SymbolTable &);
 
@@ -26,6 +27,8 @@ private:
     double _sigmaColor;
     double _sigmaSpace;
 
+    cv::Size halo() const;
+
 
 };
 }
@@ -28,6 +28,11 @@ bool BoxFilter::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const
     return true;
 }
 
+cv::Size BoxFilter::halo() const
+{
+    return OpenCVHelper::kernelHalo(_kernelSize);
+}
+
 Ilwis::OperationImplementation *BoxFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new BoxFilter(metaid,expr);
@@ -38,15 +43,8 @@ Ilwis::OperationImplementation::State BoxFilter::prepare(ExecutionContext *ctx,
     try{
         createInputOutputRasters( itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-        OperationHelper::check([&] ()->bool { return hasType(_inputRaster->datadef().domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
-            {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: image or floating-point, 1-channel or color" } );
-
-        int ksizex = _expression.input<int>(1);
-        int ksizey = _expression.input<int>(2);
-
-        _kernelSize = cv::Size(ksizex, ksizey);
-        if ( _expression.parameterCount() == 4)
-            _normalize = _expression.input<bool>(3);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -56,6 +54,21 @@ Ilwis::OperationImplementation::State BoxFilter::prepare(ExecutionContext *ctx,
     return sPREPAREFAILED;
 }
 
+bool BoxFilter::prepareFilter(const DataDefinition &input, DataDefinition &)
+{
+    OperationHelper::check([&] ()->bool { return hasType(input.domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
+        {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: image or floating-point, 1-channel or color" } );
+
+    int ksizex = _expression.input<int>(1);
+    int ksizey = _expression.input<int>(2);
+
+    _kernelSize = cv::Size(ksizex, ksizey);
+    if ( _expression.parameterCount() == 4)
+        _normalize = _expression.input<bool>(3);
+
+    return true;
+}
+
 quint64 BoxFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/boxfilter"},"opencv");
@@ -26,6 +26,8 @@ private:
     bool _normalize = true;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &);
+    cv::Size halo() const;
 
 
 };
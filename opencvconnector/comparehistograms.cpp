@@ -29,15 +29,15 @@ bool CompareHistograms::execute(ExecutionContext *ctx, SymbolTable &symTable)
 
     try{
         std::vector<double> _markers;
-        cv::SparseMat histogram1, histogram2;
+        cv::Mat histogram1, histogram2;
         auto indexes1 = _inputRaster1->stackDefinition().indexes();
         auto indexes2 = _inputRaster2->stackDefinition().indexes();
         for(int i =0; i < indexes1.size(); ++i ){
             PixelIterator inputIter1 = _inputRaster1->band(indexes1[i]);
             PixelIterator inputIter2 = _inputRaster2->band(indexes2[i]);
 
-            OpenCVHelper::createHistogram(inputIter1,histogram1, _accumulate);
-            OpenCVHelper::createHistogram(inputIter2,histogram2, _accumulate);
+            OpenCVHelper::createHistogram(inputIter1,histogram1, _accumulate, _bins);
+            OpenCVHelper::createHistogram(inputIter2,histogram2, _accumulate, _bins);
 
             if (!_accumulate)
                 _markers.push_back(cv::compareHist(histogram1, histogram2, _marker));
@@ -86,9 +86,16 @@ Ilwis::OperationImplementation::State CompareHistograms::prepare(ExecutionContex
 
         _marker = iter->second;
 
-        if ( _expression.parameterCount() == 4)
+        if ( _expression.parameterCount() >= 4)
             _accumulate = _expression.input<bool>(3);
 
+        if ( _expression.parameterCount() == 5){
+            int bins = _expression.input<int>(4);
+            OperationHelper::check([&] ()->bool { return bins >= 0; },
+            {ERR_ILLEGAL_VALUE_2,TR("number of bins"), QString::number(bins) } );
+            _bins = bins;
+        }
+
         return sPREPARED;
 
     } catch(const CheckExpressionError& err){
@@ -100,13 +107,14 @@ Ilwis::OperationImplementation::State CompareHistograms::prepare(ExecutionContex
 quint64 CompareHistograms::createMetadata()
 {
     OperationResource operation({"ilwis://operations/comparehistograms"},"opencv");
-    operation.setSyntax("CompareHistograms(inputraster1, inputraster2,correlation | chi-square | intersection | bhattacharyya-distance | hellinger-distance[,accumulated");
+    operation.setSyntax("CompareHistograms(inputraster1, inputraster2,correlation | chi-square | intersection | bhattacharyya-distance | hellinger-distance[,accumulated[,bins]]");
     operation.setDescription(TR("Blurs an image using the box filter"));
-    operation.setInParameterCount({3,4});
+    operation.setInParameterCount({3,4,5});
     operation.addInParameter(0,itRASTER , TR("first rastercoverage"),TR("raster coverage with a numerical or color domain"));
     operation.addInParameter(1,itRASTER , TR("second rastercoverage"),TR("raster coverage with the same domain as  the first coverage") );
     operation.addInParameter(2,itSTRING , TR("marker"),TR("statistical marker number to be calculated. It can be correlation, chi-square, intersection, bhattacharyya distance or hellinger distance"));
     operation.addInParameter(3,itBOOL , TR("acumulate"),TR("if there is more than one band it treats the whole raster as one; it is optional and the default is false") );
+    operation.addInParameter(4,itPOSITIVEINTEGER , TR("bins"),TR("number of bins of the histograms; 0, the default, picks a number suitable for the value type of the raster. Color rasters get a histogram per channel") );
     operation.setOutParameterCount({1});
     operation.addOutParameter(0,itDOUBLE | itCOLLECTION, TR("statistical Marker"),TR("a raster with blurred features and reduced noise"));
     operation.setKeywords("image processing,raster,noise reduction, filter");
@@ -25,6 +25,7 @@ private:
     IRasterCoverage _inputRaster1;
     IRasterCoverage _inputRaster2;
     bool _accumulate = false;
+    quint32 _bins = 0;
     int _marker;
 
 
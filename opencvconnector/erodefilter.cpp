@@ -30,6 +30,11 @@ bool ErodeFilter::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const
     return true;
 }
 
+cv::Size ErodeFilter::halo() const
+{
+    return OpenCVHelper::kernelHalo(_kernelSize, _anchor, _iterations);
+}
+
 Ilwis::OperationImplementation *ErodeFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new ErodeFilter(metaid,expr);
@@ -40,36 +45,8 @@ Ilwis::OperationImplementation::State ErodeFilter::prepare(ExecutionContext *ctx
     try{
         createInputOutputRasters( itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-
-        int iterations = _expression.input<int>(1);
-        OperationHelper::check([&] ()->bool { return iterations > 0; },
-        {ERR_ILLEGAL_VALUE_2,"iteration number", QString::number(iterations) } );
-        _iterations = iterations;
-        QString shape = _expression.input<QString>(2).toLower();
-        if ( shape == "rectangle")
-            _shape = cv::MORPH_RECT;
-        else if ( shape == "ellipse")
-            _shape = cv::MORPH_ELLIPSE;
-        else if ( shape == "cross")
-            _shape = cv::MORPH_CROSS;
-        else {
-            ERROR2(ERR_ILLEGAL_VALUE_2,TR("illegal kernel shape"), shape);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
             return sPREPAREFAILED;
-        }
-
-        int ksizex = _expression.input<int>(3);
-        int ksizey = _expression.input<int>(4);
-
-        OperationHelper::check([&] ()->bool { return ksizex > 0 && ksizey > 0; },
-        {ERR_ILLEGAL_VALUE_2,"kernel size", QString::number(ksizex) + "x" + QString::number(ksizey) } );
-
-        _kernelSize = cv::Size(ksizex, ksizey);
-        if ( _expression.parameterCount() == 7){
-            int x = _expression.input<int>(5);
-            int y = _expression.input<int>(6);
-            _anchor = cv::Point(x,y);
-        }else
-            _anchor = cv::Point(-1,-1);
 
         return sPREPARED;
 
@@ -79,6 +56,40 @@ Ilwis::OperationImplementation::State ErodeFilter::prepare(ExecutionContext *ctx
     return sPREPAREFAILED;
 }
 
+bool ErodeFilter::prepareFilter(const DataDefinition &, DataDefinition &)
+{
+    int iterations = _expression.input<int>(1);
+    OperationHelper::check([&] ()->bool { return iterations > 0; },
+    {ERR_ILLEGAL_VALUE_2,"iteration number", QString::number(iterations) } );
+    _iterations = iterations;
+    QString shape = _expression.input<QString>(2).toLower();
+    if ( shape == "rectangle")
+        _shape = cv::MORPH_RECT;
+    else if ( shape == "ellipse")
+        _shape = cv::MORPH_ELLIPSE;
+    else if ( shape == "cross")
+        _shape = cv::MORPH_CROSS;
+    else {
+        return ERROR2(ERR_ILLEGAL_VALUE_2,TR("illegal kernel shape"), shape);
+    }
+
+    int ksizex = _expression.input<int>(3);
+    int ksizey = _expression.input<int>(4);
+
+    OperationHelper::check([&] ()->bool { return ksizex > 0 && ksizey > 0; },
+    {ERR_ILLEGAL_VALUE_2,"kernel size", QString::number(ksizex) + "x" + QString::number(ksizey) } );
+
+    _kernelSize = cv::Size(ksizex, ksizey);
+    if ( _expression.parameterCount() == 7){
+        int x = _expression.input<int>(5);
+        int y = _expression.input<int>(6);
+        _anchor = cv::Point(x,y);
+    }else
+        _anchor = cv::Point(-1,-1);
+
+    return true;
+}
+
 quint64 ErodeFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/erodefilter"},"opencv");
@@ -28,6 +28,8 @@ private:
     int _shape;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &, DataDefinition &);
+    cv::Size halo() const;
 
 
 };
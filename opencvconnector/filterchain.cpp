@@ -0,0 +1,146 @@
+#include "kernel.h"
+#include "raster.h"
+#include "pixeliterator.h"
+#include "symboltable.h"
+#include "ilwisoperation.h"
+#include "opencv.hpp"
+#include "opencvhelper.h"
+#include "opencvoperation.h"
+#include "medianblurfilter.h"
+#include "gaussianblurfilter.h"
+#include "bilateralfilter.h"
+#include "adaptivebilateralfilter.h"
+#include "boxfilter.h"
+#include "erodefilter.h"
+#include "dilatefilter.h"
+#include "sobelfilter.h"
+#include "scharrfilter.h"
+#include "laplacefilter.h"
+#include "histogramequalization.h"
+#include "filterchain.h"
+
+using namespace Ilwis;
+using namespace OpenCV;
+
+REGISTER_OPERATION(FilterChain)
+
+FilterChain::FilterChain()
+{
+}
+
+FilterChain::FilterChain(quint64 metaid, const Ilwis::OperationExpression &expr) : OpenCVOperation(metaid,expr  ), _metaid(metaid)
+{
+}
+
+const std::map<QString, FilterChain::CreateFilter>& FilterChain::filterFactories()
+{
+    static const std::map<QString, CreateFilter> factories = {
+        {"medianblurfilter", MedianBlurFilter::create},
+        {"gaussianblurfilter", GaussianBlurFilter::create},
+        {"bilateralfilter", BilateralFilter::create},
+        {"adaptivebilateralfilter", AdaptiveBilateralFilter::create},
+        {"boxfilter", BoxFilter::create},
+        {"erodefilter", ErodeFilter::create},
+        {"dilatefilter", DilateFilter::create},
+        {"sobelfilter", SobelFilter::create},
+        {"scharrfilter", ScharrFilter::create},
+        {"laplacefilter", LaplaceFilter::create},
+        {"histogramequalization", HistogramEqualization::create}
+    };
+    return factories;
+}
+
+bool FilterChain::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const
+{
+    // the filters pass two buffers back and forth; opencv reuses them as long as size and type stay the same
+    cv::Mat source = cvRaster, target;
+    for(const auto& filter : _filters){
+        if (!filter->doOperation(source, target))
+            return false;
+        std::swap(source, target);
+        if ( target.data == cvRaster.data)
+            target = cv::Mat();
+    }
+    cvOutputRaster = source;
+
+    return true;
+}
+
+cv::Size FilterChain::halo() const
+{
+    cv::Size margin(0,0);
+    for(const auto& filter : _filters)
+        margin += filter->halo();
+
+    return margin;
+}
+
+bool FilterChain::isTileable() const
+{
+    for(const auto& filter : _filters)
+        if (!filter->isTileable())
+            return false;
+
+    return true;
+}
+
+Ilwis::OperationImplementation *FilterChain::create(quint64 metaid, const Ilwis::OperationExpression &expr)
+{
+    return new FilterChain(metaid,expr);
+}
+
+Ilwis::OperationImplementation::State FilterChain::prepare(ExecutionContext *ctx, const SymbolTable &symTable)
+{
+    try{
+        createInputOutputRasters( itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
+
+        QString chain = _expression.input<QString>(1).remove("\"");
+        QStringList filters = chain.split(";", QString::SkipEmptyParts);
+        OperationHelper::check([&] ()->bool { return filters.size() > 0; },
+        {ERR_ILLEGAL_VALUE_2,TR("filter chain"), chain } );
+
+        _filters.clear();
+        DataDefinition datadef = _inputRaster->datadef();
+        for(const QString& filterDef : filters){
+            QStringList parts = filterDef.trimmed().split(" ", QString::SkipEmptyParts);
+            QString name = parts.takeFirst().toLower();
+            auto iter = filterFactories().find(name);
+            OperationHelper::check([&] ()->bool { return iter != filterFactories().end(); },
+            {ERR_OPERATION_NOTSUPPORTED2, name, "filterchain" } );
+
+            // the filters only exist for their doOperation; they get no rasters of their own. Each is prepared for
+            // the data the previous filter produces
+            QString expr = QString("%1(%2%3)").arg(name).arg(_expression.input<QString>(0)).arg(parts.size() > 0 ? "," + parts.join(",") : "");
+            std::unique_ptr<OpenCVOperation> filter(static_cast<OpenCVOperation *>(iter->second(_metaid, OperationExpression(expr))));
+            DataDefinition output = datadef;
+            if ( !filter->prepareFilter(datadef, output))
+                return sPREPAREFAILED;
+            datadef = output;
+
+            _filters.push_back(std::move(filter));
+        }
+        _outputRaster->datadefRef() = datadef;
+
+        return sPREPARED;
+
+    } catch(const CheckExpressionError& err){
+        ERROR0(err.message());
+    }
+    return sPREPAREFAILED;
+}
+
+quint64 FilterChain::createMetadata()
+{
+    OperationResource operation({"ilwis://operations/filterchain"},"opencv");
+    operation.setSyntax("filterchain(inputraster, filter[;filter]*)");
+    operation.setDescription(TR("applies a sequence of opencv filters to an image, without creating the intermediate rasters"));
+    operation.setInParameterCount({2});
+    operation.addInParameter(0,itRASTER , TR("rastercoverage"));
+    operation.addInParameter(1,itSTRING , TR("filters"),TR("filters separated by ';', each written as its name followed by its parameters (without the input raster) separated by spaces, e.g. 'medianblurfilter 5;gaussianblurfilter 3 3 1.5;sobelfilter 1 0 3'"));
+    operation.setOutParameterCount({1});
+    operation.addOutParameter(0,itRASTER, TR("output raster"),TR("the raster after the last filter of the chain"));
+    operation.setKeywords("image processing,raster,filter");
+
+    mastercatalog()->addItems({operation});
+    return operation.id();
+}
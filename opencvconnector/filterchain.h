@@ -0,0 +1,40 @@
+#ifndef FILTERCHAIN_H
+#define FILTERCHAIN_H
+
+namespace Ilwis {
+namespace OpenCV {
+
+
+class FilterChain : public OpenCVOperation
+{
+public:
+    FilterChain();
+
+
+    FilterChain(quint64 metaid, const Ilwis::OperationExpression &expr);
+
+    static Ilwis::OperationImplementation *create(quint64 metaid,const Ilwis::OperationExpression& expr);
+    Ilwis::OperationImplementation::State prepare(ExecutionContext *ctx, const SymbolTable &symTable);
+
+    static quint64 createMetadata();
+
+    NEW_OPERATION(FilterChain);
+
+private:
+    typedef std::function<Ilwis::OperationImplementation *(quint64, const Ilwis::OperationExpression&)> CreateFilter;
+
+    quint64 _metaid = i64UNDEF;
+    std::vector<std::unique_ptr<OpenCVOperation>> _filters;
+
+    static const std::map<QString, CreateFilter>& filterFactories();
+
+    bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    cv::Size halo() const;
+    bool isTileable() const;
+
+
+};
+}
+}
+
+#endif // FILTERCHAIN_H
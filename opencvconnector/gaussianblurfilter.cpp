@@ -28,6 +28,15 @@ bool GaussianBlurFilter::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster)
     return true;
 }
 
+cv::Size GaussianBlurFilter::halo() const
+{
+    // a kernel size of 0 means OpenCV derives it from sigma (at most 4 sigma on each side)
+    int hx = _kernelSize.width > 0 ? _kernelSize.width / 2 : cvCeil(_sigmaX * 4);
+    int hy = _kernelSize.height > 0 ? _kernelSize.height / 2 : cvCeil((_sigmaY > 0 ? _sigmaY : _sigmaX) * 4);
+
+    return cv::Size(hx, hy);
+}
+
 Ilwis::OperationImplementation *GaussianBlurFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new GaussianBlurFilter(metaid,expr);
@@ -38,22 +47,8 @@ Ilwis::OperationImplementation::State GaussianBlurFilter::prepare(ExecutionConte
     try{
         createInputOutputRasters( itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-        OperationHelper::check([&] ()->bool { return hasType(_inputRaster->datadef().domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
-            {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: image or floating-point, 1-channel or color" } );
-
-        int ksizex = _expression.input<int>(1);
-        int ksizey = _expression.input<int>(2);
-
-        OperationHelper::check([&] ()->bool { return ksizex > 0 && ksizey > 0; },
-        {ERR_ILLEGAL_VALUE_2,"kernel size", QString::number(ksizex) + "x" + QString::number(ksizey) } );
-
-        _kernelSize = cv::Size(ksizex, ksizey);
-        _sigmaX = _expression.input<double>(3);
-        OperationHelper::check([&] ()->bool { return _sigmaX >= 0; },
-         {ERR_ILLEGAL_VALUE_2,"GaussianBlur,SigmaX", QString::number(_sigmaX)} );
-
-        if ( _expression.parameterCount() == 5)
-            _sigmaY = _expression.input<double>(4);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -63,6 +58,28 @@ Ilwis::OperationImplementation::State GaussianBlurFilter::prepare(ExecutionConte
     return sPREPAREFAILED;
 }
 
+bool GaussianBlurFilter::prepareFilter(const DataDefinition &input, DataDefinition &)
+{
+    OperationHelper::check([&] ()->bool { return hasType(input.domain()->valueType(), itUINT8 | itFLOAT | itDOUBLE | itCONTINUOUSCOLOR | itPALETTECOLOR); },
+        {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: image or floating-point, 1-channel or color" } );
+
+    int ksizex = _expression.input<int>(1);
+    int ksizey = _expression.input<int>(2);
+
+    OperationHelper::check([&] ()->bool { return ksizex > 0 && ksizey > 0; },
+    {ERR_ILLEGAL_VALUE_2,"kernel size", QString::number(ksizex) + "x" + QString::number(ksizey) } );
+
+    _kernelSize = cv::Size(ksizex, ksizey);
+    _sigmaX = _expression.input<double>(3);
+    OperationHelper::check([&] ()->bool { return _sigmaX >= 0; },
+     {ERR_ILLEGAL_VALUE_2,"GaussianBlur,SigmaX", QString::number(_sigmaX)} );
+
+    if ( _expression.parameterCount() == 5)
+        _sigmaY = _expression.input<double>(4);
+
+    return true;
+}
+
 quint64 GaussianBlurFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/gaussianglurfilter"},"opencv");
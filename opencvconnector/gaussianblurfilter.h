@@ -28,6 +28,8 @@ private:
 
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &);
+    cv::Size halo() const;
 
 
 };
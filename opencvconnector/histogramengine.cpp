@@ -0,0 +1,209 @@
+#include <deque>
+#include <future>
+#include <list>
+#include <thread>
+#include <mutex>
+#include "kernel.h"
+#include "raster.h"
+#include "pixeliterator.h"
+#include "ilwisoperation.h"
+#include "opencv.hpp"
+#include "numericrange.h"
+#include "colorrange.h"
+#include "opencvhelper.h"
+#include "histogramengine.h"
+
+using namespace Ilwis;
+using namespace OpenCV;
+
+std::list<HistogramEngine::CachedHistogram> HistogramEngine::_cache;
+std::mutex HistogramEngine::_cacheMutex;
+
+cv::Mat HistogramEngine::histogram(const IRasterCoverage &raster, qint32 layer, quint32 bins, double lower, double upper)
+{
+    if ( !raster.isValid())
+        return cv::Mat();
+
+    bool usesColor = raster->datadef().domain()->ilwisType() == itCOLORDOMAIN;
+    if ( bins == 0)
+        bins = usesColor ? 256 : defaultBins(raster->datadef().domain()->valueType());
+
+    QString key = QString("%1:%2:%3:%4:%5").arg(raster->id()).arg(layer).arg(bins).arg(lower).arg(upper);
+    {
+        std::lock_guard<std::mutex> lock(_cacheMutex);
+        for(auto iter = _cache.begin(); iter != _cache.end(); ++iter){
+            if ( (*iter)._key == key){
+                if ( (*iter)._modified != raster->modifiedTime()){
+                    _cache.erase(iter);
+                    break;
+                }
+                _cache.splice(_cache.begin(), _cache, iter);
+                return _cache.front()._histogram;
+            }
+        }
+    }
+
+    cv::Mat hist = calculate(raster, layer, bins, lower, upper);
+    if ( hist.empty())
+        return hist;
+
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    _cache.push_front({key, raster->id(), raster->modifiedTime(), hist});
+    if ( _cache.size() > MAX_CACHED)
+        _cache.pop_back();
+
+    return hist;
+}
+
+void HistogramEngine::invalidate(const IRasterCoverage &raster)
+{
+    if ( !raster.isValid())
+        return;
+
+    quint64 id = raster->id();
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    _cache.remove_if([id](const CachedHistogram& cached){ return cached._rasterid == id; });
+}
+
+quint32 HistogramEngine::defaultBins(IlwisTypes valueType)
+{
+    switch(valueType){
+    case itINT8:
+    case itUINT8:
+        return 40;
+    case itUINT16:
+    case itINT16:
+        return 80;
+    case itINT32:
+    case itUINT32:
+        return 160;
+    default:
+        return 500;
+    }
+}
+
+bool HistogramEngine::limits(const IRasterCoverage& raster, qint32 layer, double& lower, double& upper)
+{
+    const NumericStatistics& stats = raster->statistics();
+    if ( stats.isValid()){
+        lower = stats[NumericStatistics::pMIN];
+        upper = stats[NumericStatistics::pMAX];
+        return lower <= upper;
+    }
+    SPNumericRange numrange = raster->datadef().range<NumericRange>();
+    if ( !numrange.isNull() && numrange->isValid()){
+        lower = numrange->min();
+        upper = numrange->max();
+        return lower <= upper;
+    }
+    // no statistics or range to rely on; a min/max scan is still much cheaper than a full statistics pass
+    lower = 1e308;
+    upper = -1e308;
+    UPGrid& grid = raster->gridRef();
+    if ( !grid){
+        Size<> sz = raster->size();
+        PixelIterator iter(raster, BoundingBox(Pixel(0,0,layer), Pixel(sz.xsize() - 1, sz.ysize() - 1, layer)));
+        PixelIterator iterEnd = iter.end();
+        for(; iter != iterEnd; ++iter){
+            double v = *iter;
+            if ( v == rUNDEF)
+                continue;
+            lower = std::min(lower, v);
+            upper = std::max(upper, v);
+        }
+        return lower <= upper;
+    }
+    quint32 first = layer * grid->blocksPerBand();
+    for(quint32 b = first; b < first + grid->blocksPerBand(); ++b){
+        cv::Mat block = OpenCVHelper::blockAsMat(grid, b);
+        if ( block.empty())
+            return false;
+        const double *data = block.ptr<double>(0);
+        for(quint32 i = 0, n = block.rows * block.cols; i < n; ++i){
+            double v = data[i];
+            if ( v == rUNDEF)
+                continue;
+            lower = std::min(lower, v);
+            upper = std::max(upper, v);
+        }
+    }
+    return lower <= upper;
+}
+
+cv::Mat HistogramEngine::calculate(const IRasterCoverage &raster, qint32 layer, quint32 bins, double lower, double upper)
+{
+    bool usesColor = raster->datadef().domain()->ilwisType() == itCOLORDOMAIN;
+    int channels = usesColor ? 3 : 1;
+
+    bool fixedLimits = lower != rUNDEF && upper != rUNDEF;
+    if ( !usesColor && !fixedLimits && !limits(raster, layer, lower, upper))
+        return cv::Mat::zeros(channels, bins, CV_32F);
+    double scale = upper > lower ? bins / (upper - lower) : 0;
+
+    auto binBlock = [=](std::vector<double> values) -> std::vector<quint64> {
+        std::vector<quint64> counts(channels * bins, 0);
+        for(double v : values){
+            if ( v == rUNDEF)
+                continue;
+            if ( usesColor){
+                quint64 colorint = v;
+                const LocalColor *localcolor = reinterpret_cast<const LocalColor *>(&colorint);
+                ++counts[localcolor->_component1 * bins / 256];
+                ++counts[bins + localcolor->_component2 * bins / 256];
+                ++counts[2 * bins + localcolor->_component3 * bins / 256];
+            } else {
+                if ( v < lower || v > upper)
+                    continue;
+                quint32 bin = std::min(bins - 1, (quint32)((v - lower) * scale));
+                ++counts[bin];
+            }
+        }
+        return counts;
+    };
+
+    cv::Mat hist = cv::Mat::zeros(channels, bins, CV_32F);
+    auto merge = [&](const std::vector<quint64>& counts){
+        for(int c = 0; c < channels; ++c){
+            float *row = hist.ptr<float>(c);
+            for(quint32 i = 0; i < bins; ++i)
+                row[i] += counts[c * bins + i];
+        }
+    };
+
+    UPGrid& grid = raster->gridRef();
+    if ( !grid){
+        // no grid blocks to work with, fall back to the iterator
+        Size<> sz = raster->size();
+        PixelIterator iter(raster, BoundingBox(Pixel(0,0,layer), Pixel(sz.xsize() - 1, sz.ysize() - 1, layer)));
+        PixelIterator iterEnd = iter.end();
+        std::vector<double> values;
+        for(; iter != iterEnd; ++iter)
+            values.push_back(*iter);
+        merge(binBlock(std::move(values)));
+        return hist;
+    }
+
+    // the grid is only touched by this thread: a block is loaded and copied here (loading the next one may swap it out),
+    // the workers bin the copies. At most 'threads' blocks are underway
+    quint32 threads = std::max(1u, std::thread::hardware_concurrency());
+    std::deque<std::future<std::vector<quint64>>> pending;
+    quint32 first = layer * grid->blocksPerBand();
+    for(quint32 b = first; b < first + grid->blocksPerBand(); ++b){
+        cv::Mat block = OpenCVHelper::blockAsMat(grid, b);
+        if ( block.empty()){
+            for(auto& fut : pending)
+                fut.wait();
+            return cv::Mat();
+        }
+        std::vector<double> values(block.ptr<double>(0), block.ptr<double>(0) + block.rows * block.cols);
+        if ( pending.size() >= threads){
+            merge(pending.front().get());
+            pending.pop_front();
+        }
+        pending.push_back(std::async(std::launch::async, binBlock, std::move(values)));
+    }
+    for(auto& fut : pending)
+        merge(fut.get());
+
+    return hist;
+}
@@ -0,0 +1,41 @@
+#ifndef HISTOGRAMENGINE_H
+#define HISTOGRAMENGINE_H
+
+#include <list>
+
+namespace Ilwis {
+namespace OpenCV {
+
+/*!
+ * \brief The HistogramEngine class builds band histograms straight from the grid blocks of a raster.
+ *
+ * Blocks are loaded one at a time and binned in parallel into per block histograms that are merged afterwards. The result
+ * is a CV_32F matrix with one row of bins per channel (three for color rasters). The most recently used histograms are cached
+ * per raster, band and bin layout; operations that write a raster call invalidate for it. Without explicit limits the bins
+ * span the statistics or the range of the raster.
+ */
+class HistogramEngine
+{
+public:
+    static cv::Mat histogram(const IRasterCoverage& raster, qint32 layer, quint32 bins = 0, double lower = rUNDEF, double upper = rUNDEF);
+    static quint32 defaultBins(IlwisTypes valueType);
+    static void invalidate(const IRasterCoverage& raster);
+
+private:
+    struct CachedHistogram {
+        QString _key;
+        quint64 _rasterid;
+        Time _modified;
+        cv::Mat _histogram;
+    };
+    static std::list<CachedHistogram> _cache; // most recently used first
+    static std::mutex _cacheMutex;
+    static const quint32 MAX_CACHED = 16;
+
+    static bool limits(const IRasterCoverage& raster, qint32 layer, double& lower, double& upper);
+    static cv::Mat calculate(const IRasterCoverage& raster, qint32 layer, quint32 bins, double lower, double upper);
+};
+}
+}
+
+#endif // HISTOGRAMENGINE_H
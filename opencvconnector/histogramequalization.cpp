@@ -6,6 +6,7 @@
 #include "opencv.hpp"
 #include "opencvhelper.h"
 #include "opencvoperation.h"
+#include "histogramengine.h"
 #include "histogramequalization.h"
 
 using namespace Ilwis;
@@ -28,6 +29,59 @@ bool HistogramEqualization::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRast
     return true;
 }
 
+bool HistogramEqualization::doOperation(const QVariant& index, cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const
+{
+    auto iter = _lookupTables.find(index.toString());
+    if ( iter == _lookupTables.end())
+        return doOperation(cvRaster, cvOutputRaster);
+
+    cv::LUT(cvRaster, (*iter).second, cvOutputRaster);
+
+    return true;
+}
+
+bool HistogramEqualization::execute(ExecutionContext *ctx, SymbolTable &symTable)
+{
+    if (_prepState == sNOTPREPARED)
+        if((_prepState = prepare(ctx,symTable)) != sPREPARED)
+            return false;
+
+    _lookupTables.clear();
+    for(auto index : _inputRaster->stackDefinition().indexes()){
+        qint32 layer = _inputRaster->band(index).box().min_corner().z;
+        // one bin per byte value, the same histogram cv::equalizeHist would build
+        cv::Mat histogram = HistogramEngine::histogram(_inputRaster, layer, 256, 0, 255);
+        if ( histogram.empty()){
+            _lookupTables.clear();
+            break;
+        }
+        _lookupTables[QVariant(index).toString()] = equalizationTable(histogram);
+    }
+
+    return OpenCVOperation::execute(ctx, symTable);
+}
+
+cv::Mat HistogramEqualization::equalizationTable(const cv::Mat &histogram)
+{
+    cv::Mat table(1, 256, CV_8U, cv::Scalar(0));
+    const float *hist = histogram.ptr<float>(0);
+    double total = cv::sum(histogram)[0];
+    int i = 0;
+    while( i < 255 && hist[i] == 0)
+        ++i;
+    if ( hist[i] == total){
+        table.setTo(cv::Scalar(i));
+        return table;
+    }
+    double scale = 255.0 / (total - hist[i]);
+    double sum = 0;
+    for(++i; i < 256; ++i){
+        sum += hist[i];
+        table.at<uchar>(i) = cv::saturate_cast<uchar>(sum * scale);
+    }
+    return table;
+}
+
 Ilwis::OperationImplementation *HistogramEqualization::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new HistogramEqualization(metaid,expr);
@@ -38,8 +92,8 @@ Ilwis::OperationImplementation::State HistogramEqualization::prepare(ExecutionCo
     try{
         createInputOutputRasters( itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-        OperationHelper::check([&] ()->bool { return hasType(_inputRaster->datadef().domain()->valueType(), itUINT8); },
-            {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: domain image" } );
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -49,6 +103,14 @@ Ilwis::OperationImplementation::State HistogramEqualization::prepare(ExecutionCo
     return sPREPAREFAILED;
 }
 
+bool HistogramEqualization::prepareFilter(const DataDefinition &input, DataDefinition &)
+{
+    OperationHelper::check([&] ()->bool { return hasType(input.domain()->valueType(), itUINT8); },
+        {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: domain image" } );
+
+    return true;
+}
+
 quint64 HistogramEqualization::createMetadata()
 {
     OperationResource operation({"ilwis://operations/histogramhqualization"},"opencv");
@@ -18,11 +18,19 @@ public:
 
     static quint64 createMetadata();
 
+    bool execute(ExecutionContext *ctx, SymbolTable &symTable);
+
     NEW_OPERATION(HistogramEqualization);
 
 private:
+    std::map<QString, cv::Mat> _lookupTables;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &);
+    bool doOperation(const QVariant& index, cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    // with a lookup table per band, computed from the whole band, the tiles can be equalized independently
+    bool isTileable() const { return !_lookupTables.empty(); }
+    static cv::Mat equalizationTable(const cv::Mat& histogram);
 
 
 };
@@ -27,7 +27,7 @@ bool LaplaceFilter::doOperation(cv::Mat& cvRaster, cv::Mat& cvOutputRaster) cons
 
     cv::Mat cvGrey;
 
-    if ( _inputRaster->datadef().domain()->ilwisType() == itCOLORDOMAIN)
+    if ( cvRaster.channels() == 3)
         cv::cvtColor( cvRaster, cvGrey, CV_RGB2GRAY );
     else
         cvGrey = cvRaster;
@@ -40,6 +40,14 @@ bool LaplaceFilter::doOperation(cv::Mat& cvRaster, cv::Mat& cvOutputRaster) cons
 
 }
 
+cv::Size LaplaceFilter::halo() const
+{
+    // the 3x3 noise reduction blur adds one pixel to the laplacian aperture
+    int radius = std::max(1, _kernelSize / 2) + 1;
+
+    return cv::Size(radius, radius);
+}
+
 Ilwis::OperationImplementation *LaplaceFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new LaplaceFilter(metaid,expr);
@@ -50,25 +58,8 @@ Ilwis::OperationImplementation::State LaplaceFilter::prepare(ExecutionContext *c
     try{
         createInputOutputRasters(itCOORDSYSTEM | itGEOREF | itENVELOPE | itRASTERSIZE);
 
-        IDomain dom;
-        if ( _inputRaster->datadef().domain()->valueType() == itUINT8)
-            dom.prepare("image16");
-        else {
-            dom.prepare("value");
-        }
-        _outputRaster->datadefRef() = DataDefinition(dom);
-
-
-        _sourcedepth =  hasType(_inputRaster->datadef().domain()->valueType(), (itCOLOR | itPALETTECOLOR)) ? 3 : 1;
-
-        OperationHelper::check([&] ()->bool {return OpenCVHelper::determineCVType(_inputRaster->datadef().domain()->valueType(), _sourcedepth);},
-            {ERR_OPERATION_NOTSUPPORTED2, "Value type", "Laplace filter"});
-
-
-        _kernelSize = _expression.parameterCount() == 2 ? _expression.input<quint32>(1) : 1;
-        std::vector<int> possibleValue = {1,3,5,7};
-        OperationHelper::check([&] ()->bool { return (std::find(possibleValue.begin(), possibleValue.end(), _kernelSize) != possibleValue.end());},
-            {ERR_ILLEGAL_VALUE_2, "Laplace filter, kernel size", QString::number(_kernelSize)});
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -78,6 +69,31 @@ Ilwis::OperationImplementation::State LaplaceFilter::prepare(ExecutionContext *c
     return sPREPAREFAILED;
 }
 
+bool LaplaceFilter::prepareFilter(const DataDefinition &input, DataDefinition &output)
+{
+    IDomain dom;
+    if ( input.domain()->valueType() == itUINT8)
+        dom.prepare("image16");
+    else {
+        dom.prepare("value");
+    }
+    output = DataDefinition(dom);
+
+
+    _sourcedepth =  hasType(input.domain()->valueType(), (itCOLOR | itPALETTECOLOR)) ? 3 : 1;
+
+    OperationHelper::check([&] ()->bool {return OpenCVHelper::determineCVType(input.domain()->valueType(), _sourcedepth);},
+        {ERR_OPERATION_NOTSUPPORTED2, "Value type", "Laplace filter"});
+
+
+    _kernelSize = _expression.parameterCount() == 2 ? _expression.input<quint32>(1) : 1;
+    std::vector<int> possibleValue = {1,3,5,7};
+    OperationHelper::check([&] ()->bool { return (std::find(possibleValue.begin(), possibleValue.end(), _kernelSize) != possibleValue.end());},
+        {ERR_ILLEGAL_VALUE_2, "Laplace filter, kernel size", QString::number(_kernelSize)});
+
+    return true;
+}
+
 quint64 LaplaceFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/laplacefilter"},"opencv");
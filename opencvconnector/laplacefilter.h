@@ -25,6 +25,8 @@ private:
     qint8 _sourcedepth;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &output);
+    cv::Size halo() const;
 };
 }
 }
@@ -28,6 +28,11 @@ bool MedianBlurFilter::doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) c
     return true;
 }
 
+cv::Size MedianBlurFilter::halo() const
+{
+    return cv::Size(_kernelSize / 2, _kernelSize / 2);
+}
+
 Ilwis::OperationImplementation *MedianBlurFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new MedianBlurFilter(metaid,expr);
@@ -38,14 +43,8 @@ Ilwis::OperationImplementation::State MedianBlurFilter::prepare(ExecutionContext
     try{
         createInputOutputRasters( itCOORDSYSTEM | itGEOREF | itENVELOPE | itDOMAIN);
 
-        OperationHelper::check([&] ()->bool { return hasType(_inputRaster->datadef().domain()->valueType(), itNUMBER | itCONTINUOUSCOLOR | itPALETTECOLOR); },
-            {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: image or floating-point, 1-channel or color" } );
-
-        _kernelSize = _expression.input<int>(1);
-
-        OperationHelper::check([&] ()->bool { return _kernelSize > 0; },
-        {ERR_ILLEGAL_VALUE_2,"kernel size", QString::number(_kernelSize) } );
-
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
         return sPREPARED;
 
@@ -55,6 +54,19 @@ Ilwis::OperationImplementation::State MedianBlurFilter::prepare(ExecutionContext
     return sPREPAREFAILED;
 }
 
+bool MedianBlurFilter::prepareFilter(const DataDefinition &input, DataDefinition &)
+{
+    OperationHelper::check([&] ()->bool { return hasType(input.domain()->valueType(), itNUMBER | itCONTINUOUSCOLOR | itPALETTECOLOR); },
+        {ERR_COULD_NOT_LOAD_2,_expression.input<QString>(0), "wrong data type; Allowed is Source: image or floating-point, 1-channel or color" } );
+
+    _kernelSize = _expression.input<int>(1);
+
+    OperationHelper::check([&] ()->bool { return _kernelSize > 0; },
+    {ERR_ILLEGAL_VALUE_2,"kernel size", QString::number(_kernelSize) } );
+
+    return true;
+}
+
 quint64 MedianBlurFilter::createMetadata()
 {
     OperationResource operation({"ilwis://operations/medianblurfilter"},"opencv");
@@ -25,6 +25,8 @@ private:
     int _kernelSize;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &);
+    cv::Size halo() const;
 
 
 };
@@ -8,6 +8,7 @@
 #include "itemrange.h"
 #include "colorrange.h"
 #include "opencvhelper.h"
+#include "histogramengine.h"
 
 using namespace Ilwis;
 using namespace OpenCV;
@@ -16,51 +17,102 @@ OpenCVHelper::OpenCVHelper()
 {
 }
 
+namespace {
+void unpackColors(const double *source, cv::Vec3b *target, int count){
+    for(int i = 0; i < count; ++i){
+        quint64 colorint = source[i];
+        const LocalColor *localcolor = reinterpret_cast<const LocalColor *>(&colorint);
+        target[i] = cv::Vec3b(localcolor->_component1, localcolor->_component2, localcolor->_component3);
+    }
+}
+
+void packColors(const cv::Vec3b *source, double *target, int count){
+    for(int i = 0; i < count; ++i){
+        quint64 colorint = 0;
+        LocalColor *localcolor = reinterpret_cast<LocalColor *>(&colorint);
+        localcolor->_component1 = source[i][0];
+        localcolor->_component2 = source[i][1];
+        localcolor->_component3 = source[i][2];
+        localcolor->_component4 = 255;
+        target[i] = colorint;
+    }
+}
+}
+
+cv::Mat OpenCVHelper::blockAsMat(UPGrid& grid, quint32 block){
+    if ( !grid || block >= grid->blocksPerBand() * grid->size().zsize())
+        return cv::Mat();
+
+    grid->value(block, 0); // brings the block into memory if it was not loaded or was swapped out
+    char *data = grid->blockAsMemory(block, true);
+    if ( data == 0)
+        return cv::Mat();
+    int columns = grid->size().xsize();
+    int lines = grid->blockSize(block) / columns;
+
+    return cv::Mat(lines, columns, CV_64F, data);
+}
+
 bool OpenCVHelper::raster2Mat(PixelIterator rasterIter, cv::Mat& cvRaster){
 
     int opencvType = ilwisType2OpenCVType(rasterIter.raster()->datadef().domain()->valueType());
     try{
         bool usesColor = rasterIter.raster()->datadef().domain()->ilwisType() == itCOLORDOMAIN;
-        if ( usesColor){
-            const int dims[] = {(int)rasterIter.box().ylength(), (int)rasterIter.box().xlength(),3};
-            cvRaster.create(3, dims,CV_8UC3);
-        }
-        else
-            cvRaster.create(rasterIter.box().ylength(), (int)rasterIter.box().xlength(),opencvType);
+        const BoundingBox& box = rasterIter.box();
+        int rows = box.ylength();
+        int columns = box.xlength();
+        qint32 x0 = box.min_corner().x;
+        qint32 y0 = box.min_corner().y;
+        qint32 z = box.min_corner().z;
 
-        PixelIterator rasterIterEnd = rasterIter.end();
-        if ( usesColor){
-            while(rasterIter != rasterIterEnd){
-                quint64 colorint = *rasterIter;
-                LocalColor *localcolor = reinterpret_cast<LocalColor *>(&colorint);
-                cvRaster.at<quint8>(rasterIter.position().y, rasterIter.position().x, 0) = localcolor->_component1;
-                cvRaster.at<quint8>(rasterIter.position().y, rasterIter.position().x, 1) = localcolor->_component2;
-                cvRaster.at<quint8>(rasterIter.position().y, rasterIter.position().x, 2) = localcolor->_component3;
-            }
-
-        }else {
-            while(rasterIter != rasterIterEnd){
-
-                switch(opencvType){
-                case CV_8U:
-                    cvRaster.at<quint8>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
-                case CV_8S:
-                    cvRaster.at<qint8>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
-                case CV_16U:
-                    cvRaster.at<quint16>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
-                case CV_16S:
-                    cvRaster.at<qint16>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
-                case CV_32S:
-                    cvRaster.at<qint32>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
-                case CV_32F:
-                    cvRaster.at<float>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
-                case CV_64F:
-                    cvRaster.at<double>(rasterIter.position().y, rasterIter.position().x) = *rasterIter;break;
+        UPGrid& grid = rasterIter.raster()->gridRef();
+        if ( !grid){
+            // no grid blocks to work with, fall back to the iterator
+            if ( usesColor){
+                cvRaster.create(rows, columns, CV_8UC3);
+                PixelIterator rasterIterEnd = rasterIter.end();
+                while(rasterIter != rasterIterEnd){
+                    double v = *rasterIter;
+                    unpackColors(&v, &cvRaster.at<cv::Vec3b>(rasterIter.position().y - y0, rasterIter.position().x - x0), 1);
+                    ++rasterIter;
                 }
-
-
-                ++rasterIter;
+                return true;
+            }
+            switch(opencvType){
+            case CV_8U:
+                copy2Mat<quint8>(rasterIter, cvRaster, opencvType);break;
+            case CV_8S:
+                copy2Mat<qint8>(rasterIter, cvRaster, opencvType);break;
+            case CV_16U:
+                copy2Mat<quint16>(rasterIter, cvRaster, opencvType);break;
+            case CV_16S:
+                copy2Mat<qint16>(rasterIter, cvRaster, opencvType);break;
+            case CV_32S:
+                copy2Mat<qint32>(rasterIter, cvRaster, opencvType);break;
+            case CV_32F:
+                copy2Mat<float>(rasterIter, cvRaster, opencvType);break;
+            case CV_64F:
+                copy2Mat<double>(rasterIter, cvRaster, opencvType);break;
             }
+            return true;
+        }
+
+        quint32 linesPerBlock = grid->maxLines();
+        cvRaster.create(rows, columns, usesColor ? CV_8UC3 : opencvType);
+        for(qint32 y = y0; y <= box.max_corner().y; ){
+            qint32 blockStart = (y / linesPerBlock) * linesPerBlock;
+            qint32 yend = std::min(box.max_corner().y, blockStart + (qint32)linesPerBlock - 1);
+            cv::Mat block = blockAsMat(grid, z * grid->blocksPerBand() + y / linesPerBlock);
+            if ( block.empty())
+                return false;
+            cv::Mat source = block(cv::Range(y - blockStart, yend - blockStart + 1), cv::Range(x0, x0 + columns));
+            cv::Mat target = cvRaster.rowRange(y - y0, yend - y0 + 1);
+            if ( usesColor){
+                for(int r = 0; r < source.rows; ++r)
+                    unpackColors(source.ptr<double>(r), target.ptr<cv::Vec3b>(r), columns);
+            }else
+                source.convertTo(target, opencvType);
+            y = yend + 1;
         }
         return true;
     } catch(cv::Exception ex){
@@ -70,6 +122,17 @@ bool OpenCVHelper::raster2Mat(PixelIterator rasterIter, cv::Mat& cvRaster){
 }
 
 bool OpenCVHelper::mat2Raster(const cv::Mat& cvRaster, PixelIterator& iter){
+    double mmin = 1e308, mmax = -1e308;
+
+    if (!mat2Raster(cvRaster, iter, mmin, mmax))
+        return false;
+
+    iter.raster()->datadefRef().range(new NumericRange(mmin, mmax, hasType(iter.raster()->datadef().domain()->valueType(), itINTEGER) ? 1 : 0));
+
+    return true;
+}
+
+bool OpenCVHelper::mat2Raster(const cv::Mat& cvRaster, PixelIterator& iter, double& mmin, double& mmax){
     if ( !iter.isValid()){
         return false;
     }
@@ -78,26 +141,66 @@ bool OpenCVHelper::mat2Raster(const cv::Mat& cvRaster, PixelIterator& iter){
         return ERROR2(ERR_NO_INITIALIZED_2,"size", "raster");
     }
 
-    double mmin = 1e308, mmax = -1e308;
-
-    switch(cvRaster.type()){
-    case CV_8U:
-        copy2Raster<quint8>(cvRaster, iter, mmin, mmax);break;
-    case CV_8S:
-        copy2Raster<qint8>(cvRaster, iter, mmin, mmax);break;
-    case CV_16U:
-        copy2Raster<quint16>(cvRaster, iter, mmin, mmax);break;
-    case CV_16S:
-        copy2Raster<qint16>(cvRaster, iter, mmin, mmax);break;
-    case CV_32S:
-        copy2Raster<qint32>(cvRaster, iter, mmin, mmax);break;
-    case CV_32F:
-        copy2Raster<float>(cvRaster, iter, mmin, mmax);break;
-    case CV_64F:
-        copy2Raster<double>(cvRaster, iter, mmin, mmax);break;
+    bool usesColor = cvRaster.type() == CV_8UC3;
+    UPGrid& grid = iter.raster()->gridRef();
+    if ( !grid || (cvRaster.channels() != 1 && !usesColor)){
+        switch(cvRaster.type()){
+        case CV_8U:
+            copy2Raster<quint8>(cvRaster, iter, mmin, mmax);break;
+        case CV_8S:
+            copy2Raster<qint8>(cvRaster, iter, mmin, mmax);break;
+        case CV_16U:
+            copy2Raster<quint16>(cvRaster, iter, mmin, mmax);break;
+        case CV_16S:
+            copy2Raster<qint16>(cvRaster, iter, mmin, mmax);break;
+        case CV_32S:
+            copy2Raster<qint32>(cvRaster, iter, mmin, mmax);break;
+        case CV_32F:
+            copy2Raster<float>(cvRaster, iter, mmin, mmax);break;
+        case CV_64F:
+            copy2Raster<double>(cvRaster, iter, mmin, mmax);break;
+        }
+        return true;
     }
 
-    iter.raster()->datadefRef().range(new NumericRange(mmin, mmax, hasType(iter.raster()->datadef().domain()->valueType(), itINTEGER) ? 1 : 0));
+    const BoundingBox& box = iter.box();
+    qint32 x0 = box.min_corner().x;
+    qint32 y0 = box.min_corner().y;
+    qint32 z = box.min_corner().z;
+    quint32 linesPerBlock = grid->maxLines();
+    qint32 columns = grid->size().xsize();
+    for(qint32 y = y0; y <= box.max_corner().y; ){
+        quint32 block = z * grid->blocksPerBand() + y / linesPerBlock;
+        qint32 blockStart = (y / linesPerBlock) * linesPerBlock;
+        qint32 yend = std::min(box.max_corner().y, blockStart + (qint32)linesPerBlock - 1);
+        quint32 noItems = grid->blockSize(block);
+        if ( noItems == iUNDEF)
+            return false;
+        // blocks are handed to the grid as a whole; parts outside the box keep their current values
+        std::vector<double> values;
+        if ( x0 == 0 && cvRaster.cols == columns && y == blockStart && (quint32)(yend - blockStart + 1) * columns == noItems)
+            values.resize(noItems);
+        else {
+            cv::Mat current = blockAsMat(grid, block);
+            if ( current.empty())
+                return false;
+            values.assign(current.ptr<double>(0), current.ptr<double>(0) + noItems);
+        }
+        cv::Mat blockMat(noItems / columns, columns, CV_64F, values.data());
+        cv::Mat target = blockMat(cv::Range(y - blockStart, yend - blockStart + 1), cv::Range(x0, x0 + cvRaster.cols));
+        cv::Mat source = cvRaster.rowRange(y - y0, yend - y0 + 1);
+        if ( usesColor){
+            for(int r = 0; r < source.rows; ++r)
+                packColors(source.ptr<cv::Vec3b>(r), target.ptr<double>(r), source.cols);
+        } else
+            source.convertTo(target, CV_64F);
+        double lmin, lmax;
+        cv::minMaxLoc(target, &lmin, &lmax);
+        mmin = Ilwis::min(lmin, mmin);
+        mmax = Ilwis::max(lmax, mmax);
+        grid->setBlockData(block, values, false);
+        y = yend + 1;
+    }
 
     return true;
 }
@@ -133,52 +236,21 @@ IRasterCoverage OpenCVHelper::mat2Raster(const cv::Mat& cvRaster, const IGeoRefe
     return raster;
 }
 
-void OpenCVHelper::createHistogram(Ilwis::PixelIterator rasterIter, cv::SparseMat& histogram, bool accumulate){
-
-    cv::Mat cvRaster;
-    OpenCVHelper::raster2Mat(rasterIter, cvRaster);
-    IlwisTypes valueType = rasterIter.raster()->datadef().domain()->valueType();
-    if ( hasType(valueType,itNUMBER) ){
-        int channels[] = {0};
-        int bins = 300;
-        NumericStatistics& stats = rasterIter.raster()->statistics();
-        if ( !stats.isValid()){
-            stats.calculate(rasterIter,rasterIter.end());
-        }
-        double lowerLimit = rasterIter.raster()->statistics()[NumericStatistics::pMIN];
-        double upperLimit = rasterIter.raster()->statistics()[NumericStatistics::pMAX];
-        switch(valueType){
-        case itINT8:
-        case itUINT8:
-            bins = 40;
-            break;
-        case itUINT16:
-        case itINT16:
-            bins = 80;
-            break;
-        case itINT32:
-        case itUINT32:
-            bins = 200;
-            break;
-        default:
-            bins = 500;
-        }
-
-        if (hasType(valueType, itINT8))
-            bins = 40;
-        else if ( hasType(valueType , itINT16 | itUINT16))
-            bins = 80;
-        else if(hasType(valueType , itINT32 | itUINT32))
-            bins = 160;
-        int histSize[] = { bins};
-        float sranges[] = { lowerLimit, upperLimit };
-        const float * ranges[] = { sranges };
-        cv::calcHist(&cvRaster, 1, channels, cv::Mat(), histogram, 1, histSize, ranges, true,accumulate );
-    } if ( hasType(valueType,itCONTINUOUSCOLOR | itPALETTECOLOR)){
-        //TODO: histograms of color rasters
-    }
+cv::Size OpenCVHelper::kernelHalo(const cv::Size& kernelSize, const cv::Point& anchor, int iterations){
+    int ax = anchor.x < 0 ? kernelSize.width / 2 : anchor.x;
+    int ay = anchor.y < 0 ? kernelSize.height / 2 : anchor.y;
+    int hx = std::max(ax, kernelSize.width - ax - 1);
+    int hy = std::max(ay, kernelSize.height - ay - 1);
 
+    return cv::Size(hx * std::max(1, iterations), hy * std::max(1, iterations));
+}
 
+void OpenCVHelper::createHistogram(Ilwis::PixelIterator rasterIter, cv::Mat& histogram, bool accumulate, quint32 bins){
+    cv::Mat bandHistogram = HistogramEngine::histogram(rasterIter.raster(), rasterIter.box().min_corner().z, bins);
+    if ( accumulate && histogram.size() == bandHistogram.size() && histogram.type() == bandHistogram.type())
+        histogram += bandHistogram;
+    else
+        bandHistogram.copyTo(histogram);
 }
 
 IlwisTypes OpenCVHelper::openCVType2IlwisType(quint32 cvtype){
@@ -8,10 +8,13 @@ class OpenCVHelper
 public:
     OpenCVHelper();
     static bool raster2Mat(Ilwis::PixelIterator rasterIter, cv::Mat &cvRaster);
+    static cv::Mat blockAsMat(Ilwis::UPGrid& grid, quint32 block);
     static Ilwis::IRasterCoverage mat2Raster(const cv::Mat &cvRaster, const Ilwis::IGeoReference &grf);
     static quint32 ilwisType2OpenCVType(IlwisTypes tp);
     static IlwisTypes openCVType2IlwisType(quint32 cvtype);
     static bool mat2Raster(const cv::Mat &cvRaster, Ilwis::PixelIterator &iter);
+    static bool mat2Raster(const cv::Mat &cvRaster, Ilwis::PixelIterator &iter, double& mmin, double& mmax);
+    static cv::Size kernelHalo(const cv::Size& kernelSize, const cv::Point& anchor = cv::Point(-1,-1), int iterations = 1);
 
     template<typename T> static void copy2Raster(const cv::Mat& cvRaster,Ilwis::PixelIterator iter, double& mmin, double& mmax) {
 
@@ -28,8 +31,19 @@ public:
 
         }
     }
+    template<typename T> static void copy2Mat(Ilwis::PixelIterator iter, cv::Mat& cvRaster, int opencvType) {
+        cvRaster.create(iter.box().ylength(), iter.box().xlength(), opencvType);
+        for(int i = 0; i < cvRaster.rows; i++)
+        {
+            T* mi = cvRaster.ptr<T>(i);
+            for(int j = 0; j < cvRaster.cols; j++){
+                mi[j] = *iter;
+                ++iter;
+            }
+        }
+    }
     static bool determineCVType(IlwisTypes valuetype, qint8 &sourcedepth);
-    static void createHistogram(Ilwis::PixelIterator rasterIter, cv::SparseMat &histogram, bool accumulate);
+    static void createHistogram(Ilwis::PixelIterator rasterIter, cv::Mat &histogram, bool accumulate, quint32 bins = 0);
 };
 }
 }
@@ -1,3 +1,6 @@
+#include <future>
+#include <thread>
+#include <atomic>
 #include "kernel.h"
 #include <functional>
 #include "raster.h"
@@ -7,6 +10,7 @@
 #include "opencv.hpp"
 #include "opencvhelper.h"
 #include "opencvoperation.h"
+#include "histogramengine.h"
 
 using namespace Ilwis;
 using namespace OpenCV;
@@ -28,22 +32,49 @@ bool OpenCVOperation::execute(ExecutionContext *ctx, SymbolTable &symTable)
     try{
         auto indexes = _inputRaster->stackDefinition().indexes();
         _outputRaster->stackDefinitionRef().setSubDefinition(_inputRaster->stackDefinition().domain(), indexes);
-        for(auto index : indexes ){
-            PixelIterator inputIter = _inputRaster->band(index);
-
-            cv::Mat cvRaster;
-
-            if(!OpenCVHelper::raster2Mat(inputIter,cvRaster))
-                return false;
-
-            cv::Mat cvProcessed;
-            doOperation(cvRaster, cvProcessed);
-
+        for(auto index : indexes )
             _outputRaster->setBandDefinition(index,_outputRaster->datadef());
-            PixelIterator outputIter = _outputRaster->band(index);
 
-            OpenCVHelper::mat2Raster(cvProcessed,outputIter);
+        // the cores are shared between bands and the tiles within a band; opencv itself must not add a third level
+        quint32 cores = (ctx == 0 || ctx->_threaded) ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        quint32 bandThreads = std::max(1u, std::min({cores, (quint32)indexes.size(), maxBandsInMemory()}));
+        quint32 tileThreads = std::max(1u, cores / bandThreads);
+        int cvInnerThreads = std::max(1u, cores / (bandThreads * tileThreads));
+        // the opencv thread count is process wide; it is set once for all workers and restored however execute ends
+        struct CvThreadsGuard {
+            int _previous;
+            CvThreadsGuard(int threads) : _previous(cv::getNumThreads()) { cv::setNumThreads(threads); }
+            ~CvThreadsGuard() { cv::setNumThreads(_previous); }
+        } cvThreadsGuard(cvInnerThreads);
+
+        std::vector<double> bandMin(indexes.size(), 1e308), bandMax(indexes.size(), -1e308);
+        std::vector<char> bandOk(indexes.size(), false);
+        std::atomic<quint32> nextBand(0);
+        auto worker = [&]() {
+            quint32 i;
+            while((i = nextBand++) < indexes.size()){
+                bandOk[i] = executeBand(indexes[i], tileThreads, bandMin[i], bandMax[i]);
+            }
+        };
+        std::vector<std::future<void>> futures;
+        for(quint32 t = 1; t < bandThreads; ++t)
+            futures.push_back(std::async(std::launch::async, worker));
+        worker();
+        for(auto& fut : futures)
+            fut.get();
+
+        double mmin = 1e308, mmax = -1e308;
+        for(quint32 i = 0; i < indexes.size(); ++i){
+            if (!bandOk[i])
+                return false;
+            mmin = std::min(mmin, bandMin[i]);
+            mmax = std::max(mmax, bandMax[i]);
         }
+        // histograms made of the output before (e.g. by an earlier run into the same raster) no longer hold
+        HistogramEngine::invalidate(_outputRaster);
+        if ( mmin <= mmax)
+            _outputRaster->datadefRef().range(new NumericRange(mmin, mmax, hasType(_outputRaster->datadef().domain()->valueType(), itINTEGER) ? 1 : 0));
+
         if ( ctx != 0) {
             QVariant value;
             value.setValue<IRasterCoverage>(_outputRaster);
@@ -57,6 +88,106 @@ bool OpenCVOperation::execute(ExecutionContext *ctx, SymbolTable &symTable)
     return false;
 }
 
+quint32 OpenCVOperation::maxBandsInMemory() const
+{
+    // a tileable operation holds at most a few tiles of a band in memory, others the whole band (input and output)
+    Size<> sz = _inputRaster->size();
+    quint64 pixels = isTileable() && _tileSize > 0 ? std::min((quint64)sz.xsize() * sz.ysize(), (quint64)_tileSize * _tileSize * std::max(1u, std::thread::hardware_concurrency()))
+                                                  : (quint64)sz.xsize() * sz.ysize();
+    quint64 bytesPerBand = std::max(1ULL, pixels * sizeof(double) * 2);
+
+    return std::max(1ULL, _memoryBudget / bytesPerBand);
+}
+
+bool OpenCVOperation::executeBand(const QVariant& index, quint32 threads, double& mmin, double& mmax)
+{
+    qint32 inputLayer, outputLayer;
+    {
+        Locker<> lock(_gridMutex);
+        inputLayer = _inputRaster->band(index).box().min_corner().z;
+        outputLayer = _outputRaster->band(index).box().min_corner().z;
+    }
+
+    std::vector<BoundingBox> tiles = createTiles(BoundingBox(_inputRaster->size().twod()));
+    std::vector<double> tileMin(tiles.size(), 1e308), tileMax(tiles.size(), -1e308);
+    std::vector<char> tileOk(tiles.size(), false);
+
+    threads = std::max(1u, std::min((quint32)tiles.size(), threads));
+
+    std::atomic<quint32> nextTile(0);
+    auto worker = [&]() {
+        quint32 i;
+        while((i = nextTile++) < tiles.size()){
+            try{
+                tileOk[i] = executeTile(index, tiles[i], inputLayer, outputLayer, tileMin[i], tileMax[i]);
+            } catch(cv::Exception& ex){
+                ERROR0(QString::fromStdString(ex.msg));
+            } catch(const ErrorObject&){
+            }
+        }
+    };
+    std::vector<std::future<void>> futures;
+    for(quint32 t = 1; t < threads; ++t)
+        futures.push_back(std::async(std::launch::async, worker));
+    worker();
+    for(auto& fut : futures)
+        fut.get();
+
+    for(quint32 i = 0; i < tiles.size(); ++i){
+        if (!tileOk[i])
+            return false;
+        mmin = std::min(mmin, tileMin[i]);
+        mmax = std::max(mmax, tileMax[i]);
+    }
+    return true;
+}
+
+std::vector<BoundingBox> OpenCVOperation::createTiles(const BoundingBox& band) const
+{
+    std::vector<BoundingBox> tiles;
+    qint32 xsize = band.xlength();
+    qint32 ysize = band.ylength();
+    if ( !isTileable() || _tileSize == 0){
+        tiles.push_back(BoundingBox(Pixel(0,0), Pixel(xsize - 1, ysize - 1)));
+        return tiles;
+    }
+    for(qint32 y = 0; y < ysize; y += _tileSize){
+        for(qint32 x = 0; x < xsize; x += _tileSize){
+            tiles.push_back(BoundingBox(Pixel(x, y), Pixel(std::min(x + (qint32)_tileSize, xsize) - 1, std::min(y + (qint32)_tileSize, ysize) - 1)));
+        }
+    }
+    return tiles;
+}
+
+bool OpenCVOperation::executeTile(const QVariant& index, const BoundingBox& tile, qint32 inputLayer, qint32 outputLayer, double& mmin, double& mmax)
+{
+    cv::Size margin = halo();
+    Size<> sz = _inputRaster->size();
+    Pixel pmin = tile.min_corner();
+    Pixel pmax = tile.max_corner();
+    Pixel omin(std::max(0, pmin.x - margin.width), std::max(0, pmin.y - margin.height), inputLayer);
+    Pixel omax(std::min((qint32)sz.xsize() - 1, pmax.x + margin.width), std::min((qint32)sz.ysize() - 1, pmax.y + margin.height), inputLayer);
+
+    cv::Mat cvRaster;
+    {
+        Locker<> lock(_gridMutex);
+        PixelIterator inputIter(_inputRaster, BoundingBox(omin, omax));
+        if(!OpenCVHelper::raster2Mat(inputIter,cvRaster))
+            return false;
+    }
+
+    cv::Mat cvProcessed;
+    if (!doOperation(index, cvRaster, cvProcessed))
+        return false;
+
+    // only the inner part of the tile is written back; the halo was only there to feed the kernel
+    cv::Mat cvInner = cvProcessed(cv::Rect(pmin.x - omin.x, pmin.y - omin.y, pmax.x - pmin.x + 1, pmax.y - pmin.y + 1));
+
+    Locker<> lock(_gridMutex);
+    PixelIterator outputIter(_outputRaster, BoundingBox(Pixel(pmin.x, pmin.y, outputLayer), Pixel(pmax.x, pmax.y, outputLayer)));
+    return OpenCVHelper::mat2Raster(cvInner, outputIter, mmin, mmax);
+}
+
 void OpenCVOperation::createInputOutputRasters(quint64 copyProperties)
 {
     QString outputName = _expression.parm(0,false).value();
@@ -11,14 +11,34 @@ public:
     OpenCVOperation();
     OpenCVOperation(quint64 metaid, const Ilwis::OperationExpression &expr);
     virtual bool doOperation(cv::Mat& inputRaster, cv::Mat& outputRaster) const{ return false; }
+    // tiles are filtered through this one; operations that need to know the band override it
+    virtual bool doOperation(const QVariant& index, cv::Mat& inputRaster, cv::Mat& outputRaster) const{ return doOperation(inputRaster, outputRaster); }
 
     bool execute(ExecutionContext *ctx, SymbolTable &symTable);
+    // number of extra pixels a tile needs on each side so that filtering it gives the same result as filtering the whole band
+    virtual cv::Size halo() const { return cv::Size(0,0); }
+    // operations that depend on the whole band (e.g. on its histogram) can not be cut into tiles
+    virtual bool isTileable() const { return true; }
+    // checks the parameters for input with the given data definition and sets the data definition of the result.
+    // prepare does this with the rasters it created; a filter chain prepares its filters with it, without any rasters
+    virtual bool prepareFilter(const DataDefinition& input, DataDefinition& output) { return true; }
+    IRasterCoverage outputRaster() const { return _outputRaster; }
 protected:
     IRasterCoverage _inputRaster;
     IRasterCoverage _outputRaster;
     bool _resolveUndefs = false;
+    quint32 _tileSize = 1024;
+    quint64 _memoryBudget = 1024 * 1024 * 1024ULL;
 
     void createInputOutputRasters(quint64 copyProperties);
+    bool executeBand(const QVariant &index, quint32 threads, double &mmin, double &mmax);
+    quint32 maxBandsInMemory() const;
+
+private:
+    std::recursive_mutex _gridMutex;
+
+    std::vector<BoundingBox> createTiles(const BoundingBox &band) const;
+    bool executeTile(const QVariant &index, const BoundingBox &tile, qint32 inputLayer, qint32 outputLayer, double &mmin, double &mmax);
 };
 }
 }
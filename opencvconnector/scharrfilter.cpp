@@ -27,7 +27,7 @@ bool ScharrFilter::doOperation(cv::Mat& cvRaster, cv::Mat& cvOutputRaster) const
 
     cv::Mat cvGrey;
 
-    if ( _inputRaster->datadef().domain()->ilwisType() == itCOLORDOMAIN)
+    if ( cvRaster.channels() == 3)
         cv::cvtColor( cvRaster, cvGrey, CV_RGB2GRAY );
     else
         cvGrey = cvRaster;
@@ -40,6 +40,12 @@ bool ScharrFilter::doOperation(cv::Mat& cvRaster, cv::Mat& cvOutputRaster) const
     return true;
 }
 
+cv::Size ScharrFilter::halo() const
+{
+    // 3x3 noise reduction blur followed by the 3x3 Scharr kernel
+    return cv::Size(2, 2);
+}
+
 Ilwis::OperationImplementation *ScharrFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new ScharrFilter(metaid,expr);
@@ -50,38 +56,46 @@ Ilwis::OperationImplementation::State ScharrFilter::prepare(ExecutionContext *ct
     try{
         createInputOutputRasters(itCOORDSYSTEM | itGEOREF | itENVELOPE | itRASTERSIZE);
 
-        IDomain dom;
-        if ( _inputRaster->datadef().domain()->valueType() == itUINT8)
-            dom.prepare("image16");
-        else {
-            dom.prepare("value");
-        }
-        _outputRaster->datadefRef() = DataDefinition(dom);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
 
-        int xorder = _expression.input<int>(1);
-        OperationHelper::check([&] ()->bool {return (xorder >=0 || xorder <= 2);},
-            {ERR_ILLEGAL_VALUE_2,"Scharr filter, x-order", QString::number(xorder)} );
+        return sPREPARED;
 
-        int yorder = _expression.input<int>(2);
-        OperationHelper::check([&] ()->bool {return (yorder >=0 || yorder <= 2);},
-            {ERR_ILLEGAL_VALUE_2,"Scharr filter, y-order", QString::number(yorder)} );
+    } catch(const CheckExpressionError& err){
+        ERROR0(err.message());
+    }
+    return sPREPAREFAILED;
+}
 
-        _xorder = xorder;
-        _yorder = yorder;
+bool ScharrFilter::prepareFilter(const DataDefinition &input, DataDefinition &output)
+{
+    IDomain dom;
+    if ( input.domain()->valueType() == itUINT8)
+        dom.prepare("image16");
+    else {
+        dom.prepare("value");
+    }
+    output = DataDefinition(dom);
 
-        _sourcedepth =  hasType(_inputRaster->datadef().domain()->valueType(), (itCOLOR | itPALETTECOLOR)) ? 3 : 1;
+    int xorder = _expression.input<int>(1);
+    OperationHelper::check([&] ()->bool {return (xorder >=0 || xorder <= 2);},
+        {ERR_ILLEGAL_VALUE_2,"Scharr filter, x-order", QString::number(xorder)} );
 
-        OperationHelper::check([&] ()->bool {return OpenCVHelper::determineCVType(_inputRaster->datadef().domain()->valueType(), _sourcedepth);},
-            {ERR_OPERATION_NOTSUPPORTED2, "Value type", "Scharr filter"});
+    int yorder = _expression.input<int>(2);
+    OperationHelper::check([&] ()->bool {return (yorder >=0 || yorder <= 2);},
+        {ERR_ILLEGAL_VALUE_2,"Scharr filter, y-order", QString::number(yorder)} );
 
-        _destdepth = _sourcedepth == CV_8U ? CV_16U : -1;
+    _xorder = xorder;
+    _yorder = yorder;
 
-        return sPREPARED;
+    _sourcedepth =  hasType(input.domain()->valueType(), (itCOLOR | itPALETTECOLOR)) ? 3 : 1;
 
-    } catch(const CheckExpressionError& err){
-        ERROR0(err.message());
-    }
-    return sPREPAREFAILED;
+    OperationHelper::check([&] ()->bool {return OpenCVHelper::determineCVType(input.domain()->valueType(), _sourcedepth);},
+        {ERR_OPERATION_NOTSUPPORTED2, "Value type", "Scharr filter"});
+
+    _destdepth = _sourcedepth == CV_8U ? CV_16U : -1;
+
+    return true;
 }
 
 quint64 ScharrFilter::createMetadata()
@@ -27,6 +27,8 @@ private:
     qint8 _destdepth;
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &output);
+    cv::Size halo() const;
 };
 }
 }
@@ -26,7 +26,7 @@ bool SobelFilter::doOperation(cv::Mat& cvRaster, cv::Mat& cvOutputRaster) const{
 
     cv::Mat cvGrey;
 
-    if ( _inputRaster->datadef().domain()->ilwisType() == itCOLORDOMAIN)
+    if ( cvRaster.channels() == 3)
         cv::cvtColor( cvRaster, cvGrey, CV_RGB2GRAY );
     else
         cvGrey = cvRaster;
@@ -39,6 +39,14 @@ bool SobelFilter::doOperation(cv::Mat& cvRaster, cv::Mat& cvOutputRaster) const{
     return true;
 }
 
+cv::Size SobelFilter::halo() const
+{
+    // the 3x3 noise reduction blur adds one pixel to the derivative kernel
+    int radius = std::max(1, _kernelSize / 2) + 1;
+
+    return cv::Size(radius, radius);
+}
+
 Ilwis::OperationImplementation *SobelFilter::create(quint64 metaid, const Ilwis::OperationExpression &expr)
 {
     return new SobelFilter(metaid,expr);
@@ -49,43 +57,51 @@ Ilwis::OperationImplementation::State SobelFilter::prepare(ExecutionContext *ctx
     try{
         createInputOutputRasters(itCOORDSYSTEM | itGEOREF | itENVELOPE | itRASTERSIZE);
 
-        IDomain dom;
-        if ( _inputRaster->datadef().domain()->valueType() == itUINT8)
-            dom.prepare("image16");
-        else {
-            dom.prepare("value");
-        }
-        _outputRaster->datadefRef() = DataDefinition(dom);
+        if ( !prepareFilter(_inputRaster->datadef(), _outputRaster->datadefRef()))
+            return sPREPAREFAILED;
+
+        return sPREPARED;
+
+    } catch(const CheckExpressionError& err){
+        ERROR0(err.message());
+    }
+    return sPREPAREFAILED;
+}
 
-        int xorder = _expression.input<int>(1);
-        OperationHelper::check([&] ()->bool {return (xorder >=0 || xorder <= 2);},
-            {ERR_ILLEGAL_VALUE_2,"Sobel filter, x-order", QString::number(xorder)} );
+bool SobelFilter::prepareFilter(const DataDefinition &input, DataDefinition &output)
+{
+    IDomain dom;
+    if ( input.domain()->valueType() == itUINT8)
+        dom.prepare("image16");
+    else {
+        dom.prepare("value");
+    }
+    output = DataDefinition(dom);
 
-        int yorder = _expression.input<int>(2);
-        OperationHelper::check([&] ()->bool {return (yorder >=0 || yorder <= 2);},
-            {ERR_ILLEGAL_VALUE_2,"Sobel filter, y-order", QString::number(yorder)} );
+    int xorder = _expression.input<int>(1);
+    OperationHelper::check([&] ()->bool {return (xorder >=0 || xorder <= 2);},
+        {ERR_ILLEGAL_VALUE_2,"Sobel filter, x-order", QString::number(xorder)} );
 
-        _xorder = xorder;
-        _yorder = yorder;
+    int yorder = _expression.input<int>(2);
+    OperationHelper::check([&] ()->bool {return (yorder >=0 || yorder <= 2);},
+        {ERR_ILLEGAL_VALUE_2,"Sobel filter, y-order", QString::number(yorder)} );
 
-        _sourcedepth =  hasType(_inputRaster->datadef().domain()->valueType(), (itCOLOR | itPALETTECOLOR)) ? 3 : 1;
+    _xorder = xorder;
+    _yorder = yorder;
 
-        OperationHelper::check([&] ()->bool {return OpenCVHelper::determineCVType(_inputRaster->datadef().domain()->valueType(), _sourcedepth);},
-            {ERR_OPERATION_NOTSUPPORTED2, "Value type", "Sobel filter"});
+    _sourcedepth =  hasType(input.domain()->valueType(), (itCOLOR | itPALETTECOLOR)) ? 3 : 1;
 
-        _destdepth = _sourcedepth == CV_8U ? CV_16U : -1;
+    OperationHelper::check([&] ()->bool {return OpenCVHelper::determineCVType(input.domain()->valueType(), _sourcedepth);},
+        {ERR_OPERATION_NOTSUPPORTED2, "Value type", "Sobel filter"});
 
-        _kernelSize = _expression.parameterCount() == 4 ? _expression.input<quint32>(3) : 3;
-        std::vector<int> possibleValue = {1,3,5,7};
-        OperationHelper::check([&] ()->bool { return (std::find(possibleValue.begin(), possibleValue.end(), _kernelSize) != possibleValue.end()) && _kernelSize > std::max(_xorder, _yorder);},
-            {ERR_ILLEGAL_VALUE_2, "Sobel filter, kernel size", QString::number(_kernelSize)});
+    _destdepth = _sourcedepth == CV_8U ? CV_16U : -1;
 
-        return sPREPARED;
+    _kernelSize = _expression.parameterCount() == 4 ? _expression.input<quint32>(3) : 3;
+    std::vector<int> possibleValue = {1,3,5,7};
+    OperationHelper::check([&] ()->bool { return (std::find(possibleValue.begin(), possibleValue.end(), _kernelSize) != possibleValue.end()) && _kernelSize > std::max(_xorder, _yorder);},
+        {ERR_ILLEGAL_VALUE_2, "Sobel filter, kernel size", QString::number(_kernelSize)});
 
-    } catch(const CheckExpressionError& err){
-        ERROR0(err.message());
-    }
-    return sPREPAREFAILED;
+    return true;
 }
 
 quint64 SobelFilter::createMetadata()
@@ -30,6 +30,8 @@ private:
 
 
     bool doOperation(cv::Mat &cvRaster, cv::Mat &cvOutputRaster) const;
+    bool prepareFilter(const DataDefinition &input, DataDefinition &output);
+    cv::Size halo() const;
 };
 }
 }
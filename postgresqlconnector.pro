@@ -23,7 +23,8 @@ OTHER_FILES += \
     postgresqlconnector/scratch_pad.txt
 
 LIBS += -L$$PWD/../libraries/$$PLATFORM$$CONF/core/ -lilwiscore \
-        -L$$PWD/../libraries/$$PLATFORM$$CONF/ -llibgeos
+        -L$$PWD/../libraries/$$PLATFORM$$CONF/ -llibgeos \
+        -L$$PWD/../libraries/$$PLATFORM$$CONF/ -llibpq
 		
 win32:CONFIG(release, debug|release): {
     QMAKE_CXXFLAGS_RELEASE += -O2
@@ -48,7 +49,11 @@ HEADERS += \
     postgresqlconnector/postgresqlfeaturecoverageloader.h \
     postgresqlconnector/catalogconnection.h \
     postgresqlconnector/sqlstatementhelper.h \
-    postgresqlconnector/postgresqlconnection.h
+    postgresqlconnector/postgresqlconnection.h \
+    postgresqlconnector/postgresqlconnectionpool.h \
+    postgresqlconnector/postgresqlfeaturepager.h \
+    postgresqlconnector/postgresqlrasterconnector.h \
+    postgresqlconnector/postgresqlchangetracker.h
 
 SOURCES += \
     postgresqlconnector/postgresqlconnector.cpp \
@@ -62,5 +67,9 @@ SOURCES += \
     postgresqlconnector/catalogconnection.cpp \
     postgresqlconnector/sqlstatementhelper.cpp \
     postgresqlconnector/postgresqlconnection.cpp \
-    postgresqlconnector/PostgresqlDatabaseUtil.cpp
+    postgresqlconnector/PostgresqlDatabaseUtil.cpp \
+    postgresqlconnector/postgresqlconnectionpool.cpp \
+    postgresqlconnector/postgresqlfeaturepager.cpp \
+    postgresqlconnector/postgresqlrasterconnector.cpp \
+    postgresqlconnector/postgresqlchangetracker.cpp
 
@@ -1,7 +1,11 @@
+#include <atomic>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlDriver>
+#include <libpq-fe.h>
 #include <QList>
+#include <QRegExp>
 
 #include "kernel.h"
 #include "resource.h"
@@ -20,10 +24,36 @@
 
 #include "postgresqldatabaseutil.h"
 #include "sqlstatementhelper.h"
+#include "postgresqlconnectionpool.h"
 
 using namespace Ilwis;
 using namespace Postgresql;
 
+namespace {
+// splits on 'and' outside of quoted values, so "name = 'Bosnia and Herzegovina'" stays one predicate
+QStringList splitOnAnd(const QString &filter)
+{
+    QRegExp separator("\\s+and\\s+", Qt::CaseInsensitive);
+    QStringList parts;
+    int start = 0;
+    int from = 0;
+    int pos;
+    while ((pos = separator.indexIn(filter, from)) != -1) {
+        // quotes in a value are doubled, so an even count means the separator is outside a quoted value
+        if ( filter.left(pos).count('\'') % 2 == 0) {
+            parts.append(filter.mid(start, pos - start));
+            start = pos + separator.matchedLength();
+            from = start;
+        } else {
+            from = pos + 1;
+        }
+    }
+    parts.append(filter.mid(start));
+    parts.removeAll("");
+    return parts;
+}
+}
+
 PostgresqlDatabaseUtil::PostgresqlDatabaseUtil(const Resource &resource, const IOOptions &options): _resource(resource), _options(options)
 {
 }
@@ -34,48 +64,7 @@ PostgresqlDatabaseUtil::~PostgresqlDatabaseUtil()
 
 QSqlDatabase PostgresqlDatabaseUtil::openForResource(QString connectionname) const
 {
-    QUrl url = _resource.url();
-    if (connectionname.isEmpty()) {
-       connectionname = _resource.url().toString();
-    }
-
-    QSqlDatabase db;
-    if (QSqlDatabase::contains(connectionname)) {
-       db = QSqlDatabase::database(connectionname);
-    } else {
-       //qDebug() << "add pg database connection" << connectionname;
-       db = QSqlDatabase::addDatabase("QPSQL", connectionname);
-
-       qint64 port = url.port();
-       QString host = url.host();
-       QString path = url.path().split('/',QString::SkipEmptyParts).at(0);
-       validateNotNullOrEmpty("Host", host);
-       validateNotNullOrEmpty("Path", path);
-       validateNotNullOrEmpty("Port", port);
-
-       db.setHostName(host);
-       db.setDatabaseName(path);
-       db.setPort(port);
-
-       QString username = _options.contains("pg.username")
-               ? _options["pg.username"].toString()
-               : "";
-       QString password = _options.contains("pg.password")
-               ? _options["pg.password"].toString()
-               : "";
-       validateNotNullOrEmpty("Username", username);
-       validateNotNullOrEmpty("Password", password);
-
-       db.setUserName(username);
-       db.setPassword(password);
-    }
-
-    if ( !db.open()) {
-       QString error = db.lastError().text();
-       QString connection = _resource.url(true).toString();
-       ERROR2("Cannot establish connection to %1 (%2)", connection, error);
-    }
-    return db;
+    return connectionPool()->database(_resource, _options, connectionname);
 }
 
 Resource PostgresqlDatabaseUtil::resourceForType(IlwisTypes newType) const
@@ -114,31 +103,28 @@ QString Ilwis::Postgresql::PostgresqlDatabaseUtil::getInternalNameFrom(QString n
 void Ilwis::Postgresql::PostgresqlDatabaseUtil::getMetaForGeometryColumns(QList<Ilwis::Postgresql::MetaGeometryColumn> &columns) const
 {
     QString qtablename = qTableFromTableResource();
+    QString cacheKey = PostgresqlConnectionPool::poolKey(_resource, _options) + "/" + qtablename;
+    if ( connectionPool()->cachedGeometryColumns(cacheKey, columns, cacheTimeToLive())) {
+        return;
+    }
+
+    QStringList parts = qtablename.split(".");
+    QString schema = parts.size() == 1 ? "public" : parts.at(0);
+    QString table = parts.last();
+
     QString sqlBuilder;
     sqlBuilder.append("SELECT ");
     sqlBuilder.append(" * ");
     sqlBuilder.append(" FROM ");
     sqlBuilder.append(" geometry_columns ");
-    if ( !qtablename.isEmpty()) {
-        QStringList parts = qtablename.split(".");
-        QString schema;
-        QString table;
-        if (parts.size() == 1) {
-            schema = "public";
-            table = parts.at(0);
-        } else {
-            schema = parts.at(0);
-            table = parts.at(1);
-        }
-        sqlBuilder.append(" WHERE ");
-        sqlBuilder.append(" f_table_schema = '").append(schema).append("' ");
-        sqlBuilder.append(" AND ");
-        sqlBuilder.append(" f_table_name = '").append(table).append("' ");
-    }
+    sqlBuilder.append(" WHERE ");
+    sqlBuilder.append(" f_table_schema = ? ");
+    sqlBuilder.append(" AND ");
+    sqlBuilder.append(" f_table_name = ? ");
     sqlBuilder.append(" ;");
     //qDebug() << "SQL: " << sqlBuilder;
 
-    QSqlQuery query = doQuery(sqlBuilder, "tmp");
+    QSqlQuery query = doPreparedQuery(sqlBuilder, {schema, table}, "tmp");
 
     while (query.next()) {
         MetaGeometryColumn meta;
@@ -149,7 +135,8 @@ void Ilwis::Postgresql::PostgresqlDatabaseUtil::getMetaForGeometryColumns(QList<
         meta.dimension = query.value("coord_dimension").toInt();
 
         ICoordinateSystem crs;
-        QString srid = QString::number(query.value("srid").toInt());
+        meta.srid = query.value("srid").toInt();
+        QString srid = QString::number(meta.srid);
         prepareCoordinateSystem(srid, crs);
         meta.crs = crs;
 
@@ -165,6 +152,7 @@ void Ilwis::Postgresql::PostgresqlDatabaseUtil::getMetaForGeometryColumns(QList<
         meta.geomType = ilwisType;
         columns.push_back(meta);
     }
+    connectionPool()->cacheGeometryColumns(cacheKey, columns);
 
 }
 
@@ -200,9 +188,121 @@ bool Ilwis::Postgresql::PostgresqlDatabaseUtil::exists(Ilwis::SPFeatureI feature
     return query.next();
 }
 
+quint32 Ilwis::Postgresql::PostgresqlDatabaseUtil::relationPages() const
+{
+    QString sqlBuilder;
+    sqlBuilder.append("SELECT ");
+    sqlBuilder.append(" relpages ");
+    sqlBuilder.append(" FROM ");
+    sqlBuilder.append(" pg_class ");
+    sqlBuilder.append(" WHERE ");
+    sqlBuilder.append(" oid = ?::regclass ");
+    sqlBuilder.append(" ;");
+
+    QSqlQuery query = doPreparedQuery(sqlBuilder, {qTableFromTableResource()}, "tmp");
+    return query.next() ? std::max(0, query.value(0).toInt()) : 0;
+}
+
+quint32 Ilwis::Postgresql::PostgresqlDatabaseUtil::serverVersion() const
+{
+    QSqlQuery query = doQuery("SELECT current_setting('server_version_num')::integer ;", "tmp");
+    return query.next() ? std::max(0, query.value(0).toInt()) : 0;
+}
+
+QStringList Ilwis::Postgresql::PostgresqlDatabaseUtil::selectedColumns() const
+{
+    QStringList columns;
+    if ( _options.contains("pg.columns")) {
+        foreach (QString column, _options["pg.columns"].toString().split(",", QString::SkipEmptyParts)) {
+            columns.append(column.trimmed());
+        }
+    }
+    return columns;
+}
+
+bool Ilwis::Postgresql::PostgresqlDatabaseUtil::whereClause(QString &where) const
+{
+    QStringList predicates;
+
+    if ( _options.contains("pg.envelope")) {
+        QStringList parts = _options["pg.envelope"].toString().split(QRegExp("[,\\s]+"), QString::SkipEmptyParts);
+        std::vector<double> bounds;
+        foreach (QString part, parts) {
+            bool ok;
+            double value = part.toDouble(&ok);
+            if ( ok) {
+                bounds.push_back(value);
+            }
+        }
+        if ( bounds.size() != 4 || parts.size() != 4) {
+            ERROR2(ERR_ILLEGAL_VALUE_2, "pg.envelope", _options["pg.envelope"].toString());
+            return false;
+        }
+
+        QList<MetaGeometryColumn> metaGeometries;
+        getMetaForGeometryColumns(metaGeometries);
+        QString geomColumn = _options.contains("pg.envelope.column")
+                ? _options["pg.envelope.column"].toString()
+                : _options.contains("pg.features.order")
+                  ? _options["pg.features.order"].toString().split(",").first().trimmed()
+                  : "";
+        bool matched = false;
+        foreach (MetaGeometryColumn meta, metaGeometries) {
+            if ( geomColumn.isEmpty() || meta.geomColumn == geomColumn) {
+                matched = true;
+                // && only compares bounding boxes, which is what the gist index is built on
+                predicates.append(QString("%1 && ST_MakeEnvelope(%2, %3, %4, %5, %6)")
+                                  .arg(meta.geomColumn)
+                                  .arg(bounds[0],0,'g',15).arg(bounds[1],0,'g',15)
+                                  .arg(bounds[2],0,'g',15).arg(bounds[3],0,'g',15)
+                                  .arg(meta.srid));
+                break;
+            }
+        }
+        if ( !matched) {
+            // the envelope can not be applied; loading everything instead would go unnoticed
+            if ( geomColumn.isEmpty()) {
+                ERROR2(ERR_ILLEGAL_VALUE_2, "pg.envelope", _options["pg.envelope"].toString());
+            } else {
+                ERROR2(ERR_ILLEGAL_VALUE_2, "pg.envelope.column", geomColumn);
+            }
+            return false;
+        }
+    }
+
+    if ( _options.contains("pg.filter")) {
+        QRegExp predicate("^\\s*(\\w+)\\s*(<>|!=|<=|>=|=|<|>|\\blike\\b)\\s*(.+)\\s*$", Qt::CaseInsensitive);
+        QRegExp number("^[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?$");
+        QStringList expressions = splitOnAnd(_options["pg.filter"].toString());
+        foreach (QString expression, expressions) {
+            if ( !predicate.exactMatch(expression)) {
+                ERROR2(ERR_ILLEGAL_VALUE_2, "pg.filter", expression);
+                return false;
+            }
+            QString value = predicate.cap(3).trimmed();
+            if ( !number.exactMatch(value)) {
+                // everything that is not a number becomes a properly quoted string literal
+                if ( value.size() > 1 && value.startsWith("'") && value.endsWith("'")) {
+                    value = value.mid(1, value.size() - 2);
+                }
+                value = QString("'%1'").arg(value.replace("'", "''"));
+            }
+            predicates.append(QString("%1 %2 %3").arg(predicate.cap(1)).arg(predicate.cap(2).toUpper()).arg(value));
+        }
+    }
+
+    where = predicates.isEmpty() ? "" : " WHERE " + predicates.join(" AND ");
+    return true;
+}
+
 void Ilwis::Postgresql::PostgresqlDatabaseUtil::getPrimaryKeys(QList<QString> &primaryColumns) const
 {
     QString qtablename = qTableFromTableResource();
+    QString cacheKey = PostgresqlConnectionPool::poolKey(_resource, _options) + "/" + qtablename;
+    if ( connectionPool()->cachedPrimaryKeys(cacheKey, primaryColumns, cacheTimeToLive())) {
+        return;
+    }
+
     QString sqlBuilder;
     sqlBuilder.append("SELECT ");
     sqlBuilder.append(" pg_attribute.attname ");
@@ -210,7 +310,7 @@ void Ilwis::Postgresql::PostgresqlDatabaseUtil::getPrimaryKeys(QList<QString> &p
     sqlBuilder.append(" FROM ");
     sqlBuilder.append(" pg_index, pg_class, pg_attribute ");
     sqlBuilder.append(" WHERE ");
-    sqlBuilder.append(" pg_class.oid = '").append(qtablename).append("'").append("::regclass ");
+    sqlBuilder.append(" pg_class.oid = ?::regclass ");
     sqlBuilder.append(" AND ");
     sqlBuilder.append(" indrelid = pg_class.oid ");
     sqlBuilder.append(" AND ");
@@ -222,11 +322,12 @@ void Ilwis::Postgresql::PostgresqlDatabaseUtil::getPrimaryKeys(QList<QString> &p
     sqlBuilder.append(" ;");
     //qDebug() << "SQL: " << sqlBuilder;
 
-    QSqlQuery query = doQuery(sqlBuilder, "tmp");
+    QSqlQuery query = doPreparedQuery(sqlBuilder, {qtablename}, "tmp");
 
     while (query.next()) {
         primaryColumns.append(query.value(0).toString());
     }
+    connectionPool()->cachePrimaryKeys(cacheKey, primaryColumns);
 }
 
 void Ilwis::Postgresql::PostgresqlDatabaseUtil::prepareCoordinateSystem(QString srid, Ilwis::ICoordinateSystem &crs) const
@@ -276,9 +377,166 @@ QSqlQuery Ilwis::Postgresql::PostgresqlDatabaseUtil::doQuery(QString stmt, QStri
     return query;
 }
 
-void Ilwis::Postgresql::PostgresqlDatabaseUtil::validateNotNullOrEmpty(QString parameter, QVariant value) const
+bool Ilwis::Postgresql::PostgresqlDatabaseUtil::doBatchedQuery(QString stmt, std::function<bool(QSqlQuery &)> rowHandler, QString connectionName) const
 {
-    if (value.isNull() || !value.isValid()) {
-        WARN1("Property '%1' is null or empty.", parameter);
+    QSqlDatabase db = openForResource(connectionName);
+    if ( !db.isOpen()) {
+        return false;
+    }
+
+    // a cursor only exists within a transaction
+    if ( !db.transaction()) {
+        QString error = db.lastError().text();
+        ERROR2("Could not start a transaction (error: '%1'): '%2'", error, stmt);
+        return false;
+    }
+    // names are unique, a handler may run a batched query of its own on another connection of the same session
+    static std::atomic<quint64> cursorCount(0);
+    QString cursor = QString("ilwis_cursor_%1").arg(cursorCount++);
+
+    // closes the cursor and ends the transaction on every way out, also when the row handler throws
+    struct CursorGuard {
+        QSqlDatabase& _db;
+        QString _cursor;
+        bool _declared = false;
+        bool _commit = false;
+        CursorGuard(QSqlDatabase& db, const QString& cursor) : _db(db), _cursor(cursor) {}
+        ~CursorGuard() {
+            if ( _declared) {
+                QSqlQuery close(_db);
+                close.exec(QString("CLOSE %1").arg(_cursor));
+            }
+            if ( _commit) {
+                _db.commit();
+            } else {
+                _db.rollback();
+            }
+        }
+    } guard(db, cursor);
+
+    QSqlQuery declare(db);
+    if ( !declare.exec(QString("DECLARE %1 NO SCROLL CURSOR FOR %2").arg(cursor).arg(stmt))) {
+        QString error = db.lastError().text();
+        ERROR2("Could not execute sql statement (error: '%1'): '%2'", error, stmt);
+        return false;
+    }
+    guard._declared = true;
+
+    quint32 batchSize = fetchSize();
+    QString fetch = QString("FETCH FORWARD %1 FROM %2").arg(batchSize).arg(cursor);
+    bool more = true;
+    while (more) {
+        QSqlQuery batch(db);
+        batch.setForwardOnly(true);
+        if ( !batch.exec(fetch)) {
+            QString error = db.lastError().text();
+            ERROR2("Could not execute sql statement (error: '%1'): '%2'", error, fetch);
+            guard._declared = false; // the failed transaction does not accept the close anymore
+            return false;
+        }
+        quint32 rows = 0;
+        while (more && batch.next()) {
+            ++rows;
+            more = rowHandler(batch);
+        }
+        more = more && rows == batchSize;
+    }
+
+    guard._commit = true;
+    return true;
+}
+
+bool Ilwis::Postgresql::PostgresqlDatabaseUtil::copyIn(QString stmt, std::function<bool(QByteArray &)> nextRows, QString connectionName) const
+{
+    QSqlDatabase db = openForResource(connectionName);
+    QVariant handle = db.isOpen() ? db.driver()->handle() : QVariant();
+    if ( !handle.isValid() || qstrcmp(handle.typeName(), "PGconn*") != 0) {
+        ERROR1("No native postgresql connection available for '%1'", stmt);
+        return false;
+    }
+    PGconn *connection = *static_cast<PGconn **>(handle.data());
+
+    PGresult *result = PQexec(connection, stmt.toUtf8().constData());
+    bool ok = PQresultStatus(result) == PGRES_COPY_IN;
+    PQclear(result);
+    if ( !ok) {
+        ERROR2("Could not execute sql statement (error: '%1'): '%2'", QString(PQerrorMessage(connection)), stmt);
+        return false;
+    }
+
+    QByteArray rows;
+    bool more = true;
+    while (ok && more) {
+        rows.clear();
+        more = nextRows(rows);
+        if ( !rows.isEmpty()) {
+            ok = PQputCopyData(connection, rows.constData(), rows.size()) == 1;
+        }
+    }
+    // a non null message aborts the copy
+    if ( PQputCopyEnd(connection, ok ? nullptr : "copy aborted by client") != 1) {
+        ok = false;
+    }
+    while ((result = PQgetResult(connection)) != nullptr) {
+        if ( PQresultStatus(result) != PGRES_COMMAND_OK) {
+            ok = false;
+        }
+        PQclear(result);
+    }
+    if ( !ok) {
+        ERROR2("Could not execute sql statement (error: '%1'): '%2'", QString(PQerrorMessage(connection)), stmt);
+    }
+    return ok;
+}
+
+bool Ilwis::Postgresql::PostgresqlDatabaseUtil::beginTransaction(QString connectionName) const
+{
+    QSqlDatabase db = openForResource(connectionName);
+    return db.isOpen() && db.transaction();
+}
+
+bool Ilwis::Postgresql::PostgresqlDatabaseUtil::endTransaction(bool commit, QString connectionName) const
+{
+    QSqlDatabase db = openForResource(connectionName);
+    return commit ? db.commit() : db.rollback();
+}
+
+quint32 Ilwis::Postgresql::PostgresqlDatabaseUtil::fetchSize() const
+{
+    quint32 size = 10000;
+    if ( _options.contains("pg.fetch.size")) {
+        bool ok;
+        quint32 value = _options["pg.fetch.size"].toUInt(&ok);
+        if ( ok && value > 0) {
+            size = value;
+        }
+    }
+    return size;
+}
+
+QSqlQuery Ilwis::Postgresql::PostgresqlDatabaseUtil::doPreparedQuery(QString stmt, const QVariantList &values, QString connectionName) const
+{
+    QSqlDatabase db = openForResource(connectionName);
+    QSqlQuery query = connectionPool()->preparedQuery(db, stmt);
+    for (int i = 0; i < values.size(); ++i) {
+        query.bindValue(i, values.at(i));
+    }
+    if ( !query.exec()) {
+        QString error = query.lastError().text();
+        ERROR2("Could not execute sql statement (error: '%1'): '%2'", error, stmt);
+    }
+    return query;
+}
+
+quint32 Ilwis::Postgresql::PostgresqlDatabaseUtil::cacheTimeToLive() const
+{
+    quint32 ttl = 60;
+    if ( _options.contains("pg.cache.ttl")) {
+        bool ok;
+        quint32 value = _options["pg.cache.ttl"].toUInt(&ok);
+        if ( ok) {
+            ttl = value;
+        }
     }
+    return ttl;
 }
@@ -1,4 +1,9 @@
+#include <memory>
+#include <QThread>
+#include <QEvent>
+#include <QCoreApplication>
 #include <QSqlDatabase>
+#include <QSqlQuery>
 
 #include "kernel.h"
 #include "ilwisdata.h"
@@ -13,6 +18,7 @@
 #include "catalog.h"
 
 #include "postgresqldatabaseutil.h"
+#include "postgresqlconnectionpool.h"
 #include "postgresqlcatalogexplorer.h"
 
 using namespace Ilwis;
@@ -33,6 +39,72 @@ PostgresqlCatalogExplorer::~PostgresqlCatalogExplorer()
 {
 }
 
+std::map<QString, PostgresqlCatalogExplorer::ExploredSchema> PostgresqlCatalogExplorer::_explored;
+std::set<QString> PostgresqlCatalogExplorer::_running;
+std::recursive_mutex PostgresqlCatalogExplorer::_mutex;
+
+namespace Ilwis {
+namespace Postgresql {
+/*
+ * background scan of a schema. The thread object lives on the thread that started it, which is the one
+ * using the master catalog; explored batches are posted back to it and only added to the master catalog there.
+ */
+class PostgresqlCatalogScan : public QThread
+{
+public:
+    void start(const Resource &catalog, const IOOptions &options, const QString &schema, const QString &version) {
+        _catalog = catalog;
+        _options = options;
+        _schema = schema;
+        _version = version;
+        QThread::start();
+    }
+
+    ~PostgresqlCatalogScan() {
+        requestInterruption();
+        wait();
+    }
+
+    void publish(const std::vector<Resource> &batch) {
+        {
+            Locker<> lock(_pendingMutex);
+            _pending.insert(_pending.end(), batch.begin(), batch.end());
+        }
+        QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+    }
+
+protected:
+    void run() {
+        ThreadConnectionsReleaser releaser;
+        PostgresqlCatalogExplorer::explore(_catalog, _options, _schema, _version, this);
+    }
+
+    void customEvent(QEvent *) {
+        std::vector<Resource> batch;
+        {
+            Locker<> lock(_pendingMutex);
+            batch.swap(_pending);
+        }
+        if ( !batch.empty()) {
+            mastercatalog()->addItems(batch);
+        }
+    }
+
+private:
+    Resource _catalog;
+    IOOptions _options;
+    QString _schema;
+    QString _version;
+    std::vector<Resource> _pending;
+    std::recursive_mutex _pendingMutex;
+};
+}
+}
+
+// one scan per schema, reused for later scans; defined after the statics above so running scans are
+// stopped and joined before those are destroyed
+static std::map<QString, std::unique_ptr<PostgresqlCatalogScan>> scans;
+
 std::vector<Resource> PostgresqlCatalogExplorer::loadItems(const IOOptions &options)
 {
     //qDebug() << "PostgresqlCatalogExplorer::loadItems()";
@@ -43,43 +115,148 @@ std::vector<Resource> PostgresqlCatalogExplorer::loadItems(const IOOptions &opti
         schema = iooptions["pg.schema"].toString();
     }
 
+    // an unchanged schema does not have to be scanned again
+    PostgresqlDatabaseUtil pgUtil(source(), iooptions);
+    QString key = cacheKey(source(), iooptions, schema);
+    QString version = schemaVersion(pgUtil, schema);
+    std::vector<Resource> known;
+    {
+        Locker<> lock(_mutex);
+        auto iter = _explored.find(key);
+        if ( iter != _explored.end()) {
+            if ( !version.isEmpty() && iter->second._version == version) {
+                return iter->second._items;
+            }
+            known = iter->second._items;
+        }
+    }
+
+    bool async = iooptions.contains("pg.explore.async") && iooptions["pg.explore.async"].toBool();
+    if ( !async) {
+        // the caller adds the returned items to the master catalog itself
+        return explore(source(), iooptions, schema, version);
+    }
+
+    // the scan hands its resources to this thread in batches for the master catalog; meanwhile the caller gets what was known before
+    {
+        Locker<> lock(_mutex);
+        if ( _running.find(key) != _running.end()) {
+            return known;
+        }
+        _running.insert(key);
+        std::unique_ptr<PostgresqlCatalogScan>& scan = scans[key];
+        if ( !scan) {
+            scan.reset(new PostgresqlCatalogScan());
+        }
+        // a finished scan has already left the running set, its thread may still be returning
+        scan->wait();
+        scan->start(source(), iooptions, schema, version);
+    }
+    return known;
+}
+
+std::vector<Resource> PostgresqlCatalogExplorer::explore(const Resource &source, const IOOptions &options, const QString &schema, const QString &version, PostgresqlCatalogScan *scan)
+{
+    PostgresqlDatabaseUtil pgUtil(source, options);
+    quint32 batchSize = 500;
+    if ( options.contains("pg.explore.batch")) {
+        batchSize = std::max(1u, options["pg.explore.batch"].toUInt());
+    }
+
+    // geometry_columns and raster_columns only exist when the postgis extensions are installed
+    QSqlQuery extensions = pgUtil.doQuery("SELECT to_regclass('geometry_columns') IS NOT NULL AS geometries, to_regclass('raster_columns') IS NOT NULL AS rasters;", "exploreitems");
+    bool hasGeometries = extensions.next() && extensions.value("geometries").toBool();
+    bool hasRasters = extensions.isValid() && extensions.value("rasters").toBool();
+
     QString sqlBuilder;
     sqlBuilder.append("SELECT ");
-    sqlBuilder.append(" meta.tablename, count(geom.typname) as hasGeometry ");
+    sqlBuilder.append(" meta.table_name, ");
+    if ( hasGeometries) {
+        sqlBuilder.append(" EXISTS ( SELECT NULL FROM geometry_columns AS geom WHERE geom.f_table_schema = meta.table_schema AND geom.f_table_name = meta.table_name ) ");
+    } else {
+        sqlBuilder.append(" false ");
+    }
+    sqlBuilder.append(" AS hasGeometry, ");
+    if ( hasRasters) {
+        sqlBuilder.append(" EXISTS ( SELECT NULL FROM raster_columns AS rast WHERE rast.r_table_schema = meta.table_schema AND rast.r_table_name = meta.table_name ) ");
+    } else {
+        sqlBuilder.append(" false ");
+    }
+    sqlBuilder.append(" AS hasRaster ");
     sqlBuilder.append(" FROM ");
-    sqlBuilder.append(" pg_catalog.pg_tables AS meta,pg_catalog.pg_type AS geom ");
+    sqlBuilder.append(" information_schema.tables AS meta ");
     sqlBuilder.append(" WHERE ");
-    sqlBuilder.append(" meta.schemaname = '").append(schema).append("' ");
+    sqlBuilder.append(" meta.table_schema = ? ");
     sqlBuilder.append(" AND ");
-    sqlBuilder.append(" geom.typname = 'geometry' ");
-    sqlBuilder.append(" GROUP BY ");
-    sqlBuilder.append(" meta.tablename;");
-    //qDebug() << "SQL: " << sqlBuilder;
-
-    std::vector<Resource> resources;
-    PostgresqlDatabaseUtil pgUtil(source(), iooptions);
-    QSqlQuery query = pgUtil.doQuery(sqlBuilder, "exploreitems");
+    sqlBuilder.append(" meta.table_type IN ( 'BASE TABLE', 'VIEW' ) ");
+    sqlBuilder.append(" AND ");
+    sqlBuilder.append(" meta.table_name > ? ");
+    sqlBuilder.append(" ORDER BY meta.table_name ");
+    sqlBuilder.append(QString(" LIMIT %1 ;").arg(batchSize));
 
-    QString parentDatasourceNormalized = source().url().toString();
+    QString parentDatasourceNormalized = source.url().toString();
     parentDatasourceNormalized = !parentDatasourceNormalized.endsWith("/")
             ? parentDatasourceNormalized.append("/")
             : parentDatasourceNormalized;
 
+    std::vector<Resource> resources;
+    QString lastTable = "";
+    bool complete = true;
+    while (true) {
+        std::vector<Resource> batch;
+        if ( !exploreBatch(pgUtil, sqlBuilder, parentDatasourceNormalized, schema, lastTable, batch)) {
+            complete = false;
+            break;
+        }
+        if ( batch.empty()) {
+            break;
+        }
+        if ( scan) {
+            if ( scan->isInterruptionRequested()) {
+                complete = false;
+                break;
+            }
+            scan->publish(batch);
+        }
+        resources.insert(resources.end(), batch.begin(), batch.end());
+    }
+
+    QString key = cacheKey(source, options, schema);
+    Locker<> lock(_mutex);
+    if ( complete) {
+        _explored[key] = {version, resources};
+    }
+    _running.erase(key);
+    return resources;
+}
+
+bool PostgresqlCatalogExplorer::exploreBatch(const PostgresqlDatabaseUtil &pgUtil, const QString &stmt, const QString &parentUrl, const QString &schema, QString &lastTable, std::vector<Resource> &items)
+{
+    QSqlQuery query = pgUtil.doPreparedQuery(stmt, {schema, lastTable}, "exploreitems");
+    if ( !query.isActive()) {
+        return false;
+    }
+
     while (query.next()) {
         QString tablename = query.value(0).toString();
         bool hasGeometry = query.value(1).toBool();
+        bool hasRaster = query.value(2).toBool();
+        lastTable = tablename;
         if (tablename == "spatial_ref_sys") {
             continue; // skip system table
         }
-        QString resourceId = parentDatasourceNormalized;
+        QString resourceId = parentUrl;
         resourceId.append(schema);
         resourceId.append("/");
         resourceId.append(tablename);
         //qDebug() << "create new resource: " << resourceId;
 
         IlwisTypes mainType;
-        IlwisTypes extTypes;
-        if ( hasGeometry) {
+        IlwisTypes extTypes = itUNKNOWN;
+        if ( hasRaster) {
+            mainType = itRASTER;
+            extTypes = itFLATTABLE;
+        } else if ( hasGeometry) {
             mainType = itCOVERAGE;
             extTypes = itFLATTABLE;
         } else {
@@ -89,10 +266,35 @@ std::vector<Resource> PostgresqlCatalogExplorer::loadItems(const IOOptions &opti
         QUrl url(resourceId);
         Resource table(url, mainType);
         table.setExtendedType(extTypes);
-        resources.push_back(table);
+        items.push_back(table);
     }
+    return true;
+}
 
-    return resources;
+QString PostgresqlCatalogExplorer::schemaVersion(const PostgresqlDatabaseUtil &pgUtil, const QString &schema)
+{
+    // every ddl statement rewrites the pg_class row of the relation it touches, giving it a new xmin;
+    // dropped relations lower the count
+    QString sqlBuilder;
+    sqlBuilder.append("SELECT ");
+    sqlBuilder.append(" count(*) AS relations, coalesce(max(cls.xmin::text::bigint), 0) AS lastchange ");
+    sqlBuilder.append(" FROM ");
+    sqlBuilder.append(" pg_catalog.pg_class AS cls JOIN pg_catalog.pg_namespace AS nsp ON nsp.oid = cls.relnamespace ");
+    sqlBuilder.append(" WHERE ");
+    sqlBuilder.append(" nsp.nspname = ? ");
+    sqlBuilder.append(" AND ");
+    sqlBuilder.append(" cls.relkind IN ( 'r', 'v', 'm', 'p', 'f' ) ;");
+
+    QSqlQuery query = pgUtil.doPreparedQuery(sqlBuilder, {schema}, "exploreitems");
+    if ( !query.next()) {
+        return "";
+    }
+    return QString("%1:%2").arg(query.value("relations").toString()).arg(query.value("lastchange").toString());
+}
+
+QString PostgresqlCatalogExplorer::cacheKey(const Resource &source, const IOOptions &options, const QString &schema)
+{
+    return PostgresqlConnectionPool::poolKey(source, options) + "|" + schema;
 }
 
 bool PostgresqlCatalogExplorer::canUse(const Resource &resource) const
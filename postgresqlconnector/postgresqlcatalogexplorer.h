@@ -1,9 +1,16 @@
 #ifndef POSTGRESQLCATALOGEXPLORER_H
 #define POSTGRESQLCATALOGEXPLORER_H
 
+#include <map>
+#include <set>
+#include <mutex>
+
 namespace Ilwis {
 namespace Postgresql {
 
+class PostgresqlDatabaseUtil;
+class PostgresqlCatalogScan;
+
 
 class PostgresqlCatalogExplorer : public CatalogExplorer
 {
@@ -28,6 +35,21 @@ public:
     }
 
 private:
+    struct ExploredSchema {
+        QString _version;
+        std::vector<Resource> _items;
+    };
+
+    static std::map<QString, ExploredSchema> _explored;
+    static std::set<QString> _running;
+    static std::recursive_mutex _mutex;
+
+    static std::vector<Resource> explore(const Resource &source, const IOOptions &options, const QString &schema, const QString &version, PostgresqlCatalogScan *scan = nullptr);
+    static bool exploreBatch(const PostgresqlDatabaseUtil &pgUtil, const QString &stmt, const QString &parentUrl, const QString &schema, QString &lastTable, std::vector<Resource> &items);
+    static QString schemaVersion(const PostgresqlDatabaseUtil &pgUtil, const QString &schema);
+    static QString cacheKey(const Resource &source, const IOOptions &options, const QString &schema);
+
+    friend class PostgresqlCatalogScan;
 
     NEW_CATALOGEXPLORER(PostgresqlCatalogExplorer);
 };
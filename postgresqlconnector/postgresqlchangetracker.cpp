@@ -0,0 +1,176 @@
+#include <set>
+#include <sstream>
+#include <QCryptographicHash>
+#include <QList>
+
+#include "kernel.h"
+#include "ilwisdata.h"
+#include "geometries.h"
+#include "coverage.h"
+#include "datadefinition.h"
+#include "columndefinition.h"
+#include "attributedefinition.h"
+#include "table.h"
+#include "featurecoverage.h"
+#include "feature.h"
+#include "featureiterator.h"
+#include "geos/io/WKBWriter.h"
+
+#include "postgresqlchangetracker.h"
+
+using namespace Ilwis;
+using namespace Postgresql;
+
+namespace {
+std::list<std::pair<quint64, std::shared_ptr<PostgresqlChangeTracker>>> &trackers()
+{
+    static std::list<std::pair<quint64, std::shared_ptr<PostgresqlChangeTracker>>> tracked; // most recently used first
+    return tracked;
+}
+
+std::recursive_mutex &trackersMutex()
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+}
+
+PostgresqlChangeTracker::PostgresqlChangeTracker(const QStringList &keyColumns, const QStringList &geometryColumns) :
+    _keyColumns(keyColumns),
+    _geometryColumns(geometryColumns)
+{
+}
+
+std::shared_ptr<PostgresqlChangeTracker> PostgresqlChangeTracker::tracker(quint64 objectid)
+{
+    Locker<> lock(trackersMutex());
+    auto &tracked = trackers();
+    for(auto iter = tracked.begin(); iter != tracked.end(); ++iter) {
+        if ( iter->first == objectid) {
+            tracked.splice(tracked.begin(), tracked, iter);
+            return tracked.front().second;
+        }
+    }
+    return std::shared_ptr<PostgresqlChangeTracker>();
+}
+
+void PostgresqlChangeTracker::track(quint64 objectid, const std::shared_ptr<PostgresqlChangeTracker> &tracker)
+{
+    Locker<> lock(trackersMutex());
+    auto &tracked = trackers();
+    tracked.remove_if([objectid](const std::pair<quint64, std::shared_ptr<PostgresqlChangeTracker>> &item) {
+        return item.first == objectid;
+    });
+    tracked.push_front(std::make_pair(objectid, tracker));
+    // coverages that were not stored for a long time lose their tracking and are stored completely
+    if ( tracked.size() > MAX_TRACKED) {
+        tracked.pop_back();
+    }
+}
+
+QStringList PostgresqlChangeTracker::keyColumns() const
+{
+    return _keyColumns;
+}
+
+void PostgresqlChangeTracker::snapshot(FeatureCoverage *fcoverage)
+{
+    Locker<> lock(_mutex);
+    _entries.clear();
+    _pending.clear();
+    FeatureIterator featureIter(fcoverage);
+    while(featureIter != featureIter.end()) {
+        SPFeatureI feature = (*featureIter);
+        Entry entry;
+        QString keyString;
+        if ( key(feature, entry._key, keyString)) {
+            entry._fingerprint = fingerprint(feature);
+            _entries[keyString] = entry;
+        }
+        ++featureIter;
+    }
+}
+
+bool PostgresqlChangeTracker::changes(FeatureCoverage *fcoverage, std::vector<SPFeatureI> &changed, std::vector<QVariantList> &deleted)
+{
+    Locker<> lock(_mutex);
+    _pending.clear();
+    std::set<QString> seen;
+    FeatureIterator featureIter(fcoverage);
+    while(featureIter != featureIter.end()) {
+        SPFeatureI feature = (*featureIter);
+        Entry entry;
+        QString keyString;
+        if ( !key(feature, entry._key, keyString)) {
+            return false; // a feature we can not identify, only a complete store is safe
+        }
+        entry._fingerprint = fingerprint(feature);
+        auto iter = _entries.find(keyString);
+        if ( iter == _entries.end() || iter->second._fingerprint != entry._fingerprint) {
+            changed.push_back(feature);
+        }
+        seen.insert(keyString);
+        _pending[keyString] = entry;
+        ++featureIter;
+    }
+    for(const auto& item : _entries) {
+        if ( seen.find(item.first) == seen.end()) {
+            deleted.push_back(item.second._key);
+        }
+    }
+    return true;
+}
+
+void PostgresqlChangeTracker::commit()
+{
+    Locker<> lock(_mutex);
+    _entries.swap(_pending);
+    _pending.clear();
+}
+
+bool PostgresqlChangeTracker::key(const SPFeatureI &feature, QVariantList &key, QString &keyString) const
+{
+    if ( _keyColumns.isEmpty()) {
+        return false;
+    }
+    Record record = feature->record();
+    QStringList parts;
+    for(const QString& column : _keyColumns) {
+        ColumnDefinition coldef = feature->attributedefinition(column);
+        if ( !coldef.isValid()) {
+            return false;
+        }
+        QVariant value = record.cell(coldef.columnindex());
+        key.append(value);
+        parts.append(value.toString());
+    }
+    keyString = parts.join(QChar(0x1F));
+    return true;
+}
+
+QByteArray PostgresqlChangeTracker::fingerprint(const SPFeatureI &feature) const
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    Record record = feature->record();
+    for (int i = 0 ; i < feature->attributeColumnCount() ; i++) {
+        QVariant value = record.cell(i);
+        hash.addData(value.toString().toUtf8());
+        hash.addData("\x1F", 1);
+    }
+
+    geos::io::WKBWriter writer(3); // z values are written when a geometry has them
+    for(int level = 0; level < _geometryColumns.size(); ++level) {
+        const geos::geom::Geometry *geometry = level == 0
+                ? feature->geometry().get()
+                : (feature[_geometryColumns[level]] ? feature[_geometryColumns[level]]->geometry().get() : nullptr);
+        if ( geometry == nullptr) {
+            hash.addData("\x1E", 1);
+            continue;
+        }
+        std::ostringstream stream(std::ios_base::binary);
+        writer.write(*geometry, stream);
+        std::string bytes = stream.str();
+        hash.addData(bytes.data(), bytes.size());
+    }
+    return hash.result();
+}
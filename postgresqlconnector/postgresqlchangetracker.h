@@ -0,0 +1,60 @@
+#ifndef POSTGRESQLCHANGETRACKER_H
+#define POSTGRESQLCHANGETRACKER_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Ilwis {
+
+class FeatureCoverage;
+
+namespace Postgresql {
+
+/**
+ * @brief The PostgresqlChangeTracker remembers the state in which the features of a coverage were loaded.
+ *
+ * Features are identified by their primary key. For every loaded feature a fingerprint of its
+ * attributes and of the geometries of all levels is kept. Comparing the coverage against these
+ * fingerprints tells which features were added or edited (geometry or attributes) and which keys
+ * have disappeared, so a store only has to send those rows to the database.
+ *
+ * Tracking is enabled with the "pg.track.changes" option. The fingerprints of a store become the
+ * reference for the next one, so a coverage is not hashed again after it has been stored.
+ */
+class PostgresqlChangeTracker
+{
+public:
+    PostgresqlChangeTracker(const QStringList &keyColumns, const QStringList &geometryColumns);
+
+    void snapshot(FeatureCoverage *fcoverage);
+    bool changes(FeatureCoverage *fcoverage, std::vector<SPFeatureI> &changed, std::vector<QVariantList> &deleted);
+    void commit();
+    QStringList keyColumns() const;
+
+    static std::shared_ptr<PostgresqlChangeTracker> tracker(quint64 objectid);
+    static void track(quint64 objectid, const std::shared_ptr<PostgresqlChangeTracker> &tracker);
+
+private:
+    struct Entry {
+        QVariantList _key;
+        QByteArray _fingerprint;
+    };
+
+    QStringList _keyColumns;
+    QStringList _geometryColumns;
+    std::map<QString, Entry> _entries;
+    std::map<QString, Entry> _pending; // state after a store, becomes current when that store commits
+    std::recursive_mutex _mutex;
+
+    bool key(const SPFeatureI &feature, QVariantList &key, QString &keyString) const;
+    QByteArray fingerprint(const SPFeatureI &feature) const;
+
+    static const quint32 MAX_TRACKED = 32;
+};
+
+}
+}
+
+#endif // POSTGRESQLCHANGETRACKER_H
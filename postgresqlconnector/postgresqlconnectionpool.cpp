@@ -0,0 +1,210 @@
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QList>
+
+#include "kernel.h"
+#include "resource.h"
+#include "geometries.h"
+#include "ilwisdata.h"
+#include "coordinatesystem.h"
+
+#include "postgresqldatabaseutil.h"
+#include "postgresqlconnectionpool.h"
+
+using namespace Ilwis;
+using namespace Postgresql;
+
+PostgresqlConnectionPool *Ilwis::Postgresql::connectionPool()
+{
+    static PostgresqlConnectionPool pool;
+    return &pool;
+}
+
+PostgresqlConnectionPool::PostgresqlConnectionPool()
+{
+}
+
+PostgresqlConnectionPool::~PostgresqlConnectionPool()
+{
+}
+
+QString PostgresqlConnectionPool::poolKey(const Resource &resource, const IOOptions &options)
+{
+    QUrl url = resource.url();
+    QString database = url.path().split('/',QString::SkipEmptyParts).value(0);
+    QString username = options.contains("pg.username") ? options["pg.username"].toString() : "";
+    return QString("%1:%2/%3/%4").arg(url.host()).arg(url.port()).arg(database).arg(username);
+}
+
+QSqlDatabase PostgresqlConnectionPool::database(const Resource &resource, const IOOptions &options, const QString &purpose)
+{
+    quintptr thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    QString name = QString("%1|%2|%3").arg(poolKey(resource, options)).arg(purpose.isEmpty() ? "default" : purpose).arg(thread);
+
+    Locker<> lock(_mutex);
+    evictIdle(thread, name);
+
+    QDateTime now = QDateTime::currentDateTime();
+    QSqlDatabase db;
+    auto iter = _connections.find(name);
+    if ( iter == _connections.end()) {
+        db = QSqlDatabase::addDatabase("QPSQL", name);
+        setupConnection(db, resource, options);
+        PooledConnection connection;
+        connection._name = name;
+        connection._thread = thread;
+        _connections[name] = connection;
+    } else {
+        db = QSqlDatabase::database(name, false);
+        if ( iter->second._lastUsed.secsTo(now) > _healthCheckInterval && !isAlive(db)) {
+            // the server may have dropped us; prepared statements died with the old session
+            iter->second._statements.clear();
+            db.close();
+        }
+    }
+    _connections[name]._lastUsed = now;
+
+    if ( !db.isOpen() && !db.open()) {
+        QString error = db.lastError().text();
+        QString connection = resource.url(true).toString();
+        ERROR2("Cannot establish connection to %1 (%2)", connection, error);
+    }
+    return db;
+}
+
+QSqlQuery PostgresqlConnectionPool::preparedQuery(const QSqlDatabase &db, const QString &stmt)
+{
+    Locker<> lock(_mutex);
+    auto iter = _connections.find(db.connectionName());
+    if ( iter == _connections.end()) {
+        QSqlQuery query(db);
+        query.prepare(stmt);
+        return query;
+    }
+    auto &statements = iter->second._statements;
+    auto found = statements.find(stmt);
+    if ( found == statements.end()) {
+        QSqlQuery query(db);
+        if ( !query.prepare(stmt)) {
+            return query; // not cached, the caller sees the error when executing
+        }
+        found = statements.insert(std::make_pair(stmt, query)).first;
+    }
+    return found->second;
+}
+
+void PostgresqlConnectionPool::releaseThread()
+{
+    // for worker threads that end; nobody else could ever close their connections
+    quintptr thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    Locker<> lock(_mutex);
+    for(auto iter = _connections.begin(); iter != _connections.end();) {
+        if ( iter->second._thread == thread) {
+            QString name = iter->second._name;
+            iter->second._statements.clear();
+            QSqlDatabase::database(name, false).close();
+            iter = _connections.erase(iter);
+            QSqlDatabase::removeDatabase(name);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool PostgresqlConnectionPool::cachedGeometryColumns(const QString &key, QList<MetaGeometryColumn> &columns, quint32 ttl)
+{
+    Locker<> lock(_mutex);
+    auto iter = _geometryColumns.find(key);
+    if ( ttl == 0 || iter == _geometryColumns.end() || iter->second._stored.secsTo(QDateTime::currentDateTime()) > ttl) {
+        return false;
+    }
+    columns = iter->second._value;
+    return true;
+}
+
+void PostgresqlConnectionPool::cacheGeometryColumns(const QString &key, const QList<MetaGeometryColumn> &columns)
+{
+    Locker<> lock(_mutex);
+    _geometryColumns[key] = {QDateTime::currentDateTime(), columns};
+}
+
+bool PostgresqlConnectionPool::cachedPrimaryKeys(const QString &key, QList<QString> &primaryKeys, quint32 ttl)
+{
+    Locker<> lock(_mutex);
+    auto iter = _primaryKeys.find(key);
+    if ( ttl == 0 || iter == _primaryKeys.end() || iter->second._stored.secsTo(QDateTime::currentDateTime()) > ttl) {
+        return false;
+    }
+    primaryKeys = iter->second._value;
+    return true;
+}
+
+void PostgresqlConnectionPool::cachePrimaryKeys(const QString &key, const QList<QString> &primaryKeys)
+{
+    Locker<> lock(_mutex);
+    _primaryKeys[key] = {QDateTime::currentDateTime(), primaryKeys};
+}
+
+void PostgresqlConnectionPool::invalidateMetadata(const QString &key)
+{
+    Locker<> lock(_mutex);
+    _geometryColumns.erase(key);
+    _primaryKeys.erase(key);
+}
+
+void PostgresqlConnectionPool::evictIdle(quintptr thread, const QString &except)
+{
+    // connections can only be closed by the thread that owns them
+    QDateTime now = QDateTime::currentDateTime();
+    for(auto iter = _connections.begin(); iter != _connections.end();) {
+        PooledConnection &connection = iter->second;
+        if ( connection._thread == thread && connection._name != except && connection._lastUsed.secsTo(now) > _idleTimeout) {
+            QString name = connection._name;
+            connection._statements.clear();
+            QSqlDatabase::database(name, false).close();
+            iter = _connections.erase(iter);
+            QSqlDatabase::removeDatabase(name);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool PostgresqlConnectionPool::isAlive(QSqlDatabase &db) const
+{
+    if ( !db.isOpen()) {
+        return false;
+    }
+    QSqlQuery ping(db);
+    return ping.exec("SELECT 1;");
+}
+
+void PostgresqlConnectionPool::setupConnection(QSqlDatabase &db, const Resource &resource, const IOOptions &options) const
+{
+    QUrl url = resource.url();
+    qint64 port = url.port();
+    QString host = url.host();
+    QString path = url.path().split('/',QString::SkipEmptyParts).value(0);
+    if ( host.isEmpty() || path.isEmpty() || port < 0) {
+        WARN1("Incomplete connection properties in '%1'.", url.toString());
+    }
+
+    db.setHostName(host);
+    db.setDatabaseName(path);
+    db.setPort(port);
+
+    QString username = options.contains("pg.username")
+            ? options["pg.username"].toString()
+            : "";
+    QString password = options.contains("pg.password")
+            ? options["pg.password"].toString()
+            : "";
+    if ( username.isEmpty() || password.isEmpty()) {
+        WARN1("No credentials given for '%1'.", url.toString());
+    }
+
+    db.setUserName(username);
+    db.setPassword(password);
+}
@@ -0,0 +1,89 @@
+#ifndef POSTGRESQLCONNECTIONPOOL_H
+#define POSTGRESQLCONNECTIONPOOL_H
+
+#include <mutex>
+#include <map>
+#include <QDateTime>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+namespace Ilwis {
+
+class Resource;
+
+namespace Postgresql {
+
+struct MetaGeometryColumn;
+
+/**
+ * @brief The PostgresqlConnectionPool keeps database connections open between loads.
+ *
+ * Connections are keyed by host, port, database and user. A QSqlDatabase may only be used
+ * in the thread that created it, so every thread gets its own connection for each purpose
+ * (a purpose being the connection name the loaders use to keep e.g. an open cursor apart from
+ * other statements). A connection that has not been used for a while is checked before it is
+ * handed out again, and connections idle for longer than the idle timeout are closed.
+ *
+ * The pool also caches prepared statements per connection and the catalog metadata
+ * (geometry columns, primary keys) per table for a limited time.
+ */
+class PostgresqlConnectionPool
+{
+public:
+    PostgresqlConnectionPool();
+    ~PostgresqlConnectionPool();
+
+    QSqlDatabase database(const Resource &resource, const IOOptions &options, const QString &purpose);
+    QSqlQuery preparedQuery(const QSqlDatabase &db, const QString &stmt);
+    void releaseThread();
+
+    bool cachedGeometryColumns(const QString &key, QList<MetaGeometryColumn> &columns, quint32 ttl);
+    void cacheGeometryColumns(const QString &key, const QList<MetaGeometryColumn> &columns);
+    bool cachedPrimaryKeys(const QString &key, QList<QString> &primaryKeys, quint32 ttl);
+    void cachePrimaryKeys(const QString &key, const QList<QString> &primaryKeys);
+    void invalidateMetadata(const QString &key);
+
+    static QString poolKey(const Resource &resource, const IOOptions &options);
+
+private:
+    struct PooledConnection {
+        QString _name;
+        quintptr _thread = 0;
+        QDateTime _lastUsed;
+        std::map<QString, QSqlQuery> _statements;
+    };
+    template<typename T> struct CachedValue {
+        QDateTime _stored;
+        T _value;
+    };
+
+    std::recursive_mutex _mutex;
+    std::map<QString, PooledConnection> _connections;
+    std::map<QString, CachedValue<QList<MetaGeometryColumn>>> _geometryColumns;
+    std::map<QString, CachedValue<QList<QString>>> _primaryKeys;
+    quint32 _idleTimeout = 300;
+    quint32 _healthCheckInterval = 30;
+
+    void evictIdle(quintptr thread, const QString &except);
+    bool isAlive(QSqlDatabase &db) const;
+    void setupConnection(QSqlDatabase &db, const Resource &resource, const IOOptions &options) const;
+};
+
+PostgresqlConnectionPool *connectionPool();
+
+/**
+ * @brief The ThreadConnectionsReleaser closes the pooled connections of the current thread when it
+ * goes out of scope. Worker threads create one before their first query, so their connections are
+ * also released when the work throws.
+ */
+struct ThreadConnectionsReleaser {
+    ThreadConnectionsReleaser() {}
+    ~ThreadConnectionsReleaser() { connectionPool()->releaseThread(); }
+    ThreadConnectionsReleaser(const ThreadConnectionsReleaser&) = delete;
+    ThreadConnectionsReleaser& operator=(const ThreadConnectionsReleaser&) = delete;
+};
+
+}
+}
+
+#endif // POSTGRESQLCONNECTIONPOOL_H
@@ -2,6 +2,7 @@
 #define POSTGRESQLDATABASEUTIL_H
 
 
+#include <functional>
 #include "kernel.h"
 #include "resource.h"
 #include "geometries.h"
@@ -20,6 +21,7 @@ struct MetaGeometryColumn {
     QString tableName;
     QString geomColumn;
     int dimension;
+    int srid = 0;
     ICoordinateSystem crs;
     IlwisTypes geomType;
     QString qtablename() {
@@ -63,6 +65,41 @@ public:
 
     bool exists(SPFeatureI feature) const;
 
+    /**
+     * @brief relationPages the number of heap pages of the table according to the planner statistics.
+     * @return the (estimated) number of pages, 0 if unknown
+     */
+    quint32 relationPages() const;
+
+    /**
+     * @brief serverVersion the version of the server as in server_version_num (e.g. 140005 for 14.5).
+     * @return the version number, 0 if unknown
+     */
+    quint32 serverVersion() const;
+
+    /**
+     * @brief selectedColumns the attribute columns to load as set with the "pg.columns" option
+     * (comma separated). Primary keys are always loaded.
+     * @return the column names, or an empty list if all columns have to be loaded
+     */
+    QStringList selectedColumns() const;
+
+    /**
+     * @brief whereClause builds the WHERE clause which restricts a select to the features of interest.
+     *
+     * Two options are pushed down into the database:
+     * <ul>
+     * <li>"pg.envelope" (minx,miny,maxx,maxy in the crs of the geometry column) selects the rows whose
+     * bounding box overlaps the envelope, so that a spatial index can be used. The geometry column
+     * is the root geometry column unless "pg.envelope.column" is given.</li>
+     * <li>"pg.filter" holds simple attribute predicates (e.g. "province = 'Utrecht' and pop > 1000"),
+     * combined with 'and'. The operators =, <>, !=, <, >, <=, >= and like are supported.</li>
+     * </ul>
+     * @param where the clause (including the WHERE keyword), empty if nothing has to be filtered
+     * @return false if one of the options could not be parsed
+     */
+    bool whereClause(QString &where) const;
+
     void getPrimaryKeys(QList<QString> &primaryColumns) const;
 
     void prepareCoordinateSystem(QString srid, ICoordinateSystem &crs) const;
@@ -71,25 +108,71 @@ public:
 
     QSqlQuery doQuery(QString stmt, QString connectionname="") const;
 
+    /**
+     * @brief doPreparedQuery executes a statement with ? placeholders. The statement is prepared once
+     * per pooled connection and reused afterwards.
+     */
+    QSqlQuery doPreparedQuery(QString stmt, const QVariantList &values, QString connectionname="") const;
+
+    /**
+     * @brief doBatchedQuery runs a select statement through a server side cursor.
+     *
+     * Rows are fetched in batches of fetchSize() rows, so only one batch is held in client
+     * memory at a time. Each row is handed to the rowHandler as soon as its batch has arrived;
+     * the handler can stop the fetching by returning false. The cursor lives in a transaction
+     * on the named connection, so that connection can not be used for other statements meanwhile.
+     * @param stmt the select statement
+     * @param rowHandler called for each row; the query is positioned on the row
+     * @param connectionname the name of the connection.
+     * @return false if the statement could not be executed
+     */
+    bool doBatchedQuery(QString stmt, std::function<bool(QSqlQuery &)> rowHandler, QString connectionname="") const;
+
+    /**
+     * @brief copyIn streams rows into the database with COPY ... FROM STDIN.
+     *
+     * The rows are requested in chunks from nextRows, which appends lines in the text format
+     * of COPY (see copyValueString of SqlStatementHelper) and returns false after the last chunk.
+     * The copy runs on the native libpq handle of the named connection, so temporary tables and
+     * transactions of that connection are visible to it.
+     * @param stmt the COPY statement, e.g. "COPY tmp (a,b) FROM STDIN"
+     * @param nextRows fills the next chunk of rows
+     * @param connectionname the name of the connection.
+     * @return false if the copy could not be started or was rejected by the database
+     */
+    bool copyIn(QString stmt, std::function<bool(QByteArray &)> nextRows, QString connectionname="") const;
+
+    bool beginTransaction(QString connectionname="") const;
+    bool endTransaction(bool commit, QString connectionname="") const;
+
+    /**
+     * @brief fetchSize the number of rows per batch when reading through a cursor, can be set
+     * with the "pg.fetch.size" option.
+     * @return the number of rows per batch
+     */
+    quint32 fetchSize() const;
+
 private:
     Resource _resource;
     IOOptions _options;
 
     /**
-     * @brief openForResource creates a named database connection.
+     * @brief openForResource gets a named database connection from the connection pool.
      *
-     * Creates a named database connection. The connection is being opened by default. Logs a warning
-     * if expected user credentials are missing or empty. Database can be retrieved by
-     * \code{.cpp}
-     *  QSqlDatabase::database("connectionname");
-     * \endcode
+     * The connection is being opened by default. Logs a warning if expected user credentials are
+     * missing or empty. Connections are pooled per server, database, user and thread, so the name
+     * only distinguishes connections used for different purposes at the same time.
      * A connectionname can be empty, then the default connection is being used.
      * @param connectionname the name of the connection.
      * @return a database connection setup with the given user credentials.
      */
     QSqlDatabase openForResource(QString connectionname="") const;
 
-    void validateNotNullOrEmpty(QString parameter, QVariant value) const;
+    /**
+     * @brief cacheTimeToLive the number of seconds cached catalog metadata stays valid, can be set
+     * with the "pg.cache.ttl" option.
+     */
+    quint32 cacheTimeToLive() const;
 
 };
 
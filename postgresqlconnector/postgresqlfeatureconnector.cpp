@@ -31,6 +31,7 @@
 #include "postgresqldatabaseutil.h"
 #include "postgresqlfeatureconnector.h"
 #include "postgresqlfeaturecoverageloader.h"
+#include "postgresqlfeaturepager.h"
 
 using namespace Ilwis;
 using namespace Postgresql;
@@ -88,6 +89,8 @@ bool PostgresqlFeatureConnector::store(IlwisObject *data, const IOOptions& optio
     IOOptions iooptions = options.isEmpty() ? this->ioOptions() : options;
     PostgresqlFeatureCoverageLoader loader = PostgresqlFeatureCoverageLoader(source(), iooptions);
     bool ok = loader.storeData(fcoverage);
+    // cached pages of the table no longer reflect its rows, also when the store failed halfway
+    PostgresqlFeaturePager::invalidate(source());
     return ok;
 }
 
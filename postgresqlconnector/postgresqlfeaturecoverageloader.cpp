@@ -1,9 +1,13 @@
 #include <iostream>
+#include <sstream>
 #include <array>
+#include <future>
+#include <thread>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QList>
+#include <QtEndian>
 
 #include "kernel.h"
 #include "ilwisdata.h"
@@ -24,26 +28,55 @@
 #include "basetable.h"
 #include "flattable.h"
 #include "geometryhelper.h"
+#include "geos/io/WKBReader.h"
+#include "geos/io/WKBWriter.h"
+#include "geos/io/WKBConstants.h"
+#include "geos/util/GEOSException.h"
 #include "connectorinterface.h"
 #include "ilwisobjectconnector.h"
 
 #include "postgresqlconnector.h"
 #include "postgresqlfeaturecoverageloader.h"
 #include "postgresqltableconnector.h"
-#include "postgresqltableloader.h"
+#include "postgresqlconnectionpool.h"
 #include "postgresqldatabaseutil.h"
+#include "postgresqlfeaturepager.h"
+#include "postgresqlchangetracker.h"
 #include "sqlstatementhelper.h"
 
 using namespace Ilwis;
 using namespace Postgresql;
 
+namespace {
+// hex ewkb of a geometry: its (little endian) wkb with the srid of the column added to the header
+QString hexEwkb(geos::io::WKBWriter &writer, const geos::geom::Geometry *geometry, int srid)
+{
+    std::ostringstream stream(std::ios_base::binary);
+    writer.write(*geometry, stream);
+    std::string wkb = stream.str();
+    QByteArray ewkb(wkb.data(), (int)wkb.size());
+    if ( srid > 0 && ewkb.size() >= 5) {
+        uchar *header = reinterpret_cast<uchar *>(ewkb.data());
+        quint32 type = qFromLittleEndian<quint32>(header + 1) | 0x20000000;
+        qToLittleEndian<quint32>(type, header + 1);
+        uchar sridBytes[4];
+        qToLittleEndian<quint32>((quint32)srid, sridBytes);
+        ewkb.insert(5, reinterpret_cast<const char *>(sridBytes), 4);
+    }
+    return QString::fromLatin1(ewkb.toHex());
+}
+}
+
 PostgresqlFeatureCoverageLoader::PostgresqlFeatureCoverageLoader(const Resource &resource, const IOOptions &options): _resource(resource), _options(options)
 {
+    // geometries are transferred as (e)wkb unless wkt is explicitly asked for
+    if ( _options.contains("pg.geometry.transfer")) {
+        _binaryGeometries = _options["pg.geometry.transfer"].toString().toLower() != "wkt";
+    }
 }
 
 PostgresqlFeatureCoverageLoader::~PostgresqlFeatureCoverageLoader()
 {
-    QSqlDatabase::removeDatabase("featurecoverageloader");
 }
 
 bool PostgresqlFeatureCoverageLoader::loadMetadata(FeatureCoverage *fcoverage) const
@@ -82,25 +115,71 @@ void PostgresqlFeatureCoverageLoader::setSubfeatureSemantics(FeatureCoverage *fc
     fcoverage->attributeDefinitionsRef().setSubDefinition(semantics, items);
 }
 
-QString PostgresqlFeatureCoverageLoader::selectGeometries(const QList<MetaGeometryColumn> &metaGeometry) const
+QString PostgresqlFeatureCoverageLoader::geometryColumns(const QList<MetaGeometryColumn> &metaGeometry) const
 {
     QString columns;
-    std::for_each(metaGeometry.begin(), metaGeometry.end(), [&columns](MetaGeometryColumn meta) {
-        columns.append(" ST_AsText(");
+    QString asFunction = _binaryGeometries ? " ST_AsEWKB(" : " ST_AsText(";
+    std::for_each(metaGeometry.begin(), metaGeometry.end(), [&columns,asFunction](MetaGeometryColumn meta) {
+        columns.append(asFunction);
         columns.append(meta.geomColumn).append(") AS ");
         columns.append(meta.geomColumn).append(",");
     });
-    columns = columns.left(columns.size() - 1);
-
-    QString sqlBuilder;
-    sqlBuilder.append("SELECT ");
-    sqlBuilder.append(columns);
-    sqlBuilder.append(" FROM ");
+    return columns.left(columns.size() - 1);
+}
 
+QString PostgresqlFeatureCoverageLoader::selectFeatures(const ITable &table, const QList<MetaGeometryColumn> &metaGeometries, std::vector<QString> &attributeColumns) const
+{
+    // attributes and geometries come from one select, so a row can not get out of step with its record
+    attributeColumns.assign(table->columnCount(), QString());
+    QStringList selectColumns;
+    for (int i = 0; i < table->columnCount(); i++) {
+        ColumnDefinition& coldef = table->columndefinitionRef(i);
+        selectColumns.append(coldef.name());
+        if( !coldef.datadef().domain().isValid()) {
+            WARN2(ERR_NO_INITIALIZED_2, "domain", coldef.name());
+            continue;
+        }
+        attributeColumns[i] = coldef.name();
+    }
+    if ( !metaGeometries.isEmpty()) {
+        selectColumns.append(geometryColumns(metaGeometries));
+    }
     PostgresqlDatabaseUtil pgUtil(_resource,_options);
-    sqlBuilder.append(pgUtil.qTableFromTableResource());
-    //qDebug() << "SQL: " << sqlBuilder;
-    return sqlBuilder;
+    return QString("SELECT %1 FROM %2").arg(selectColumns.join(", ")).arg(pgUtil.qTableFromTableResource());
+}
+
+std::vector<PostgresqlFeatureCoverageLoader::GeometryColumn> PostgresqlFeatureCoverageLoader::orderedGeometryColumns(const IDomain &semantics, const QList<MetaGeometryColumn> &metaGeometries) const
+{
+    std::vector<GeometryColumn> columns;
+    if ( metaGeometries.isEmpty()) {
+        return columns;
+    }
+    // iterate semantics to keep predefined order; index 0 is root, indeces > 0 are subfeatures of root
+    ItemRangeIterator iter(semantics->range<>().data());
+    while (iter.isValid()) {
+        GeometryColumn column;
+        column._name = (*iter)->name();
+        std::for_each(metaGeometries.begin(), metaGeometries.end(), [&column](MetaGeometryColumn c) {
+            if (c.geomColumn == column._name) {
+                column._crs = c.crs;
+            }
+        });
+        columns.push_back(column);
+        ++iter;
+    }
+    return columns;
+}
+
+void PostgresqlFeatureCoverageLoader::addFeature(FeatureCoverage *fcoverage, const std::vector<GeometryColumn> &columns, const std::vector<geos::geom::Geometry *> &geometries) const
+{
+    if (columns.empty()) {
+        fcoverage->newFeature(0);
+        return;
+    }
+    SPFeatureI rootFeature = fcoverage->newFeature(geometries[0], false);
+    for(quint32 i = 1; i < columns.size(); ++i) {
+        rootFeature->createSubFeature(columns[i]._name, geometries[i]);
+    }
 }
 
 bool PostgresqlFeatureCoverageLoader::loadData(FeatureCoverage *fcoverage) const
@@ -112,58 +191,396 @@ bool PostgresqlFeatureCoverageLoader::loadData(FeatureCoverage *fcoverage) const
     Resource tableResource = pgUtil.resourceForType(itFLATTABLE);
     table.prepare(tableResource, _options);
 
-    PostgresqlTableLoader tableLoader(table->source(), _options);
-    if (!tableLoader.loadData(table.ptr())) {
-        ERROR1("Could not load table data for table '%1'", table->name());
+    QList<MetaGeometryColumn> metaGeometries;
+    pgUtil.getMetaForGeometryColumns(metaGeometries);
+    IDomain semantics;
+    pgUtil.prepareSubFeatureSemantics(semantics, metaGeometries);
+    std::vector<GeometryColumn> columns = orderedGeometryColumns(semantics, metaGeometries);
+
+    bool ok;
+    if ( _options.contains("pg.page") || _options.contains("pg.feature.key")) {
+        ok = loadPage(fcoverage, table, columns);
+    } else {
+        quint32 partitions = partitionCount(pgUtil);
+        ok = partitions > 1
+                ? loadPartitioned(fcoverage, table, metaGeometries, columns, partitions)
+                : loadSequential(fcoverage, table, metaGeometries, columns);
+    }
+    if ( !ok) {
+        return false;
+    }
+    fcoverage->attributesFromTable(table);
+    trackChanges(fcoverage, pgUtil, columns);
+
+    return true;
+}
+
+void PostgresqlFeatureCoverageLoader::trackChanges(FeatureCoverage *fcoverage, const PostgresqlDatabaseUtil &pgUtil, const std::vector<GeometryColumn> &columns) const
+{
+    // tracking fingerprints every feature at load and again at each store, so it is only done on request
+    if ( !_options.contains("pg.track.changes") || !_options["pg.track.changes"].toBool()) {
+        return;
+    }
+    QList<QString> primaryKeys;
+    pgUtil.getPrimaryKeys(primaryKeys);
+    if ( primaryKeys.isEmpty()) {
+        return; // rows can not be identified, stores always write everything
+    }
+    QStringList geometryColumns;
+    for(const GeometryColumn& column : columns) {
+        geometryColumns.append(column._name);
+    }
+    auto tracker = std::make_shared<PostgresqlChangeTracker>(QStringList(primaryKeys), geometryColumns);
+    tracker->snapshot(fcoverage);
+    PostgresqlChangeTracker::track(fcoverage->id(), tracker);
+}
+
+bool PostgresqlFeatureCoverageLoader::loadSequential(FeatureCoverage *fcoverage, ITable &table, const QList<MetaGeometryColumn> &metaGeometries, const std::vector<GeometryColumn> &columns) const
+{
+    PostgresqlDatabaseUtil pgUtil(_resource,_options);
+    QString where;
+    if ( !pgUtil.whereClause(where)) {
         return false;
     }
+    std::vector<QString> attributeColumns;
+    QString stmt = selectFeatures(table, metaGeometries, attributeColumns) + where;
 
+    // prevents the table from loading itself when its first record is set
+    table->dataLoaded(true);
     // metadata already set it to correct number, creating new features will up the count agains; so reset to 0.
     fcoverage->setFeatureCount(itFEATURE, iUNDEF, FeatureInfo::ALLFEATURES);
 
-    QList<MetaGeometryColumn> metaGeometries;
-    pgUtil.getMetaForGeometryColumns(metaGeometries);
-    QSqlQuery query = pgUtil.doQuery(selectGeometries(metaGeometries), "featurecoverageloader");
-    quint32 geometriesPerFeature = metaGeometries.size();
+    quint64 count = 0;
+    auto toFeature = [&](QSqlQuery &query) {
+        std::vector<QVariant> record(attributeColumns.size());
+        for(quint32 i = 0; i < attributeColumns.size(); ++i) {
+            if ( !attributeColumns[i].isEmpty()) {
+                record[i] = query.value(attributeColumns[i]);
+            }
+        }
+        table->record(count++, record);
+        std::vector<geos::geom::Geometry *> geometries;
+        for(const GeometryColumn& column : columns) {
+            geometries.push_back(createGeometry(fcoverage, query, column._name, column._crs));
+        }
+        addFeature(fcoverage, columns, geometries);
+        return true;
+    };
+    return pgUtil.doBatchedQuery(stmt, toFeature, "featurecoverageloader");
+}
 
-    IDomain semantics;
-    pgUtil.prepareSubFeatureSemantics(semantics, metaGeometries);
+bool PostgresqlFeatureCoverageLoader::loadPage(FeatureCoverage *fcoverage, ITable &table, const std::vector<GeometryColumn> &columns) const
+{
+    QStringList attributeColumns;
+    for (int i = 0; i < table->columnCount(); i++) {
+        ColumnDefinition& coldef = table->columndefinitionRef(i);
+        attributeColumns.append(coldef.datadef().domain().isValid() ? coldef.name() : "");
+    }
+    QStringList geometryColumns;
+    for(const GeometryColumn& column : columns) {
+        geometryColumns.append(column._name);
+    }
+    auto pager = PostgresqlFeaturePager::pager(_resource, _options, attributeColumns, geometryColumns);
+
+    PostgresqlFeaturePager::Page page;
+    if ( _options.contains("pg.feature.key")) {
+        // point query, the key values are given in primary key order
+        QVariantList key;
+        foreach (QString value, _options["pg.feature.key"].toString().split(",")) {
+            key.append(value.trimmed());
+        }
+        auto rows = std::make_shared<std::vector<PostgresqlFeaturePager::Row>>();
+        PostgresqlFeaturePager::Row row;
+        if ( pager->row(key, row)) {
+            rows->push_back(row);
+        }
+        page = rows;
+    } else {
+        page = pager->page(_options["pg.page"].toULongLong());
+    }
+    if ( !page) {
+        return false;
+    }
 
-    while (query.next()) {
-        if (geometriesPerFeature == 0) {
-            fcoverage->newFeature(0);
-        } else {
-            // index 0 is root, indeces > 0 are subfeatures of root
-            bool atRoot = true;
-            SPFeatureI rootFeature;
-            // iterate semantics to keep predefined order
-            ItemRangeIterator iter(semantics->range<>().data());
-            while (iter.isValid()) {
-                QString geomName = (*iter)->name();
-                ICoordinateSystem crs;
-                std::for_each(metaGeometries.begin(), metaGeometries.end(), [&crs,geomName](MetaGeometryColumn c) {
-                    if (c.geomColumn == geomName) {
-                        crs = c.crs;
+    // prevents the table from loading itself when its first record is set
+    table->dataLoaded(true);
+    // metadata already set it to correct number, creating new features will up the count agains; so reset to 0.
+    fcoverage->setFeatureCount(itFEATURE, iUNDEF, FeatureInfo::ALLFEATURES);
+
+    quint64 count = 0;
+    for(const PostgresqlFeaturePager::Row& row : *page) {
+        table->record(count++, row._record);
+        std::vector<geos::geom::Geometry *> geometries;
+        for(quint32 i = 0; i < columns.size(); ++i) {
+            geos::geom::Geometry *geometry = fromWKB(fcoverage, row._geometries[i]);
+            if ( geometry) {
+                GeometryHelper::setCoordinateSystem(geometry, columns[i]._crs.ptr());
+            }
+            geometries.push_back(geometry);
+        }
+        addFeature(fcoverage, columns, geometries);
+    }
+    return true;
+}
+
+quint32 PostgresqlFeatureCoverageLoader::partitionCount(const PostgresqlDatabaseUtil &pgUtil) const
+{
+    // ctid ranges only prune pages from 14 on (tid range scan); before that every partition scans the whole table
+    if ( pgUtil.serverVersion() < 140000) {
+        return 1;
+    }
+    if ( _options.contains("pg.load.partitions")) {
+        return std::max(1u, _options["pg.load.partitions"].toUInt());
+    }
+    // small tables are not worth the extra connections; every partition holds its own connection
+    quint32 threads = std::min(8u, std::max(1u, std::thread::hardware_concurrency()));
+    return pgUtil.relationPages() >= 1024 ? threads : 1;
+}
+
+bool PostgresqlFeatureCoverageLoader::loadPartitioned(FeatureCoverage *fcoverage, ITable &table, const QList<MetaGeometryColumn> &metaGeometries, const std::vector<GeometryColumn> &columns, quint32 partitions) const
+{
+    PostgresqlDatabaseUtil pgUtil(_resource,_options);
+    QString where;
+    if ( !pgUtil.whereClause(where)) {
+        return false;
+    }
+
+    std::vector<QString> attributeColumns;
+    QString select = selectFeatures(table, metaGeometries, attributeColumns);
+
+    // the table is cut into ranges of heap pages; ordering on ctid makes the result independent of the scheduling
+    quint32 pages = std::max(partitions, pgUtil.relationPages());
+    struct Row {
+        std::vector<QVariant> _record;
+        std::vector<geos::geom::Geometry *> _geometries;
+    };
+    struct Partition {
+        bool _ok = false;
+        std::vector<Row> _rows;
+    };
+    std::vector<std::future<Partition>> futures;
+    for(quint32 p = 0; p < partitions; ++p) {
+        QString range = QString("ctid >= '(%1,0)'::tid").arg((quint64)pages * p / partitions);
+        if ( p < partitions - 1) {
+            range += QString(" AND ctid < '(%1,0)'::tid").arg((quint64)pages * (p + 1) / partitions);
+        }
+        QString stmt = select + (where.isEmpty() ? " WHERE " : where + " AND ") + range + " ORDER BY ctid";
+        futures.push_back(std::async(std::launch::async, [this, stmt, fcoverage, &attributeColumns, &columns]() {
+            // the worker thread ends with the load; its connection would otherwise never be closed
+            ThreadConnectionsReleaser releaser;
+            Partition partition;
+            auto toRow = [&](QSqlQuery &query) {
+                Row row;
+                row._record.resize(attributeColumns.size());
+                for(quint32 i = 0; i < attributeColumns.size(); ++i) {
+                    if ( !attributeColumns[i].isEmpty()) {
+                        row._record[i] = query.value(attributeColumns[i]);
                     }
-                });
-                if (atRoot) {
-                    atRoot = false;
-                    geos::geom::Geometry *rootGeometry = createGeometry(query, geomName, crs);
-                    rootFeature = fcoverage->newFeature(rootGeometry, false);
+                }
+                // geometry decoding is the expensive part and runs here, on the worker
+                for(const GeometryColumn& column : columns) {
+                    row._geometries.push_back(createGeometry(fcoverage, query, column._name, column._crs));
+                }
+                partition._rows.push_back(std::move(row));
+                return true;
+            };
+            // rows arrive through a cursor, fetchSize at a time
+            PostgresqlDatabaseUtil partitionUtil(_resource,_options);
+            partition._ok = partitionUtil.doBatchedQuery(stmt, toRow, "featurecoverageloader.partition");
+            return partition;
+        }));
+    }
+
+    // prevents the table from loading itself when its first record is set
+    table->dataLoaded(true);
+    // metadata already set it to correct number, creating new features will up the count agains; so reset to 0.
+    fcoverage->setFeatureCount(itFEATURE, iUNDEF, FeatureInfo::ALLFEATURES);
+
+    // merging happens in partition order, as soon as the next partition is available
+    bool ok = true;
+    quint64 count = 0;
+    for(auto& fut : futures) {
+        Partition partition = fut.get();
+        ok = ok && partition._ok;
+        for(Row& row : partition._rows) {
+            if ( ok) {
+                table->record(count++, row._record);
+                addFeature(fcoverage, columns, row._geometries);
+            } else {
+                for(geos::geom::Geometry *geometry : row._geometries) {
+                    delete geometry;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+bool PostgresqlFeatureCoverageLoader::storeData(FeatureCoverage *fcoverage) const
+{
+    if ( _options.contains("pg.store.mode") && _options["pg.store.mode"].toString() == "statements") {
+        return storeFeatureByFeature(fcoverage);
+    }
+    return bulkStoreData(fcoverage);
+}
+
+bool PostgresqlFeatureCoverageLoader::bulkStoreData(FeatureCoverage *fcoverage) const
+{
+    ITable baseData = fcoverage->attributeTable();
+    PostgresqlDatabaseUtil pgUtil(_resource, _options);
+    SqlStatementHelper sqlHelper(pgUtil);
+
+    QList<MetaGeometryColumn> metaGeomColumns;
+    pgUtil.getMetaForGeometryColumns(metaGeomColumns);
+    QString rootGeomColumn = fcoverage->attributeDefinitionsRef().index((quint32)0);
+
+    QStringList columns;
+    for (int i = 0 ; i < baseData->columnCount() ; i++) {
+        columns.append(baseData->columndefinition(i).name());
+    }
+    foreach (MetaGeometryColumn geomMeta, metaGeomColumns) {
+        columns.append(geomMeta.geomColumn);
+    }
+
+    // a coverage that was loaded from the database only sends what changed since it was loaded or last stored
+    std::vector<SPFeatureI> changed;
+    std::vector<QVariantList> deleted;
+    std::shared_ptr<PostgresqlChangeTracker> tracker = PostgresqlChangeTracker::tracker(fcoverage->id());
+    bool delta = tracker && _options["pg.store.mode"].toString() != "full" && tracker->changes(fcoverage, changed, deleted);
+    if ( delta && changed.empty() && deleted.empty()) {
+        return true;
+    }
+
+    // without a primary key stored rows can not be matched to table rows, they would be duplicated or lost
+    QList<QString> primaryKeys;
+    pgUtil.getPrimaryKeys(primaryKeys);
+    if ( primaryKeys.isEmpty()) {
+        return ERROR1("No primary key on table '%1', features can not be stored.", pgUtil.qTableFromTableResource());
+    }
+
+    // rows are copied into temp tables and merged into the real table with one delete and one upsert;
+    // the temp tables are dropped at commit
+    QString connection = "featurecoverageloader.store";
+    QString tmpTable = "ilwis_feature_upsert";
+    if ( !pgUtil.beginTransaction(connection)) {
+        return false;
+    }
+
+    if ( !deleted.empty() && !deleteFeatures(pgUtil, sqlHelper, baseData, tracker->keyColumns(), deleted, connection)) {
+        pgUtil.endTransaction(false, connection);
+        return false;
+    }
+
+    if ( !delta || !changed.empty()) {
+        sqlHelper.addCreateTempTableStmt(tmpTable);
+        QSqlQuery createQuery = pgUtil.doQuery(sqlHelper.sql(), connection);
+        sqlHelper.clearStatements();
+        if ( !createQuery.isActive()) {
+            pgUtil.endTransaction(false, connection);
+            return false;
+        }
+
+        FeatureIterator featureIter(fcoverage);
+        auto changedIter = changed.begin();
+        auto hasNext = [&]() {
+            return delta ? changedIter != changed.end() : featureIter != featureIter.end();
+        };
+        quint32 batchSize = pgUtil.fetchSize();
+        geos::io::WKBWriter wkbWriter(3, geos::io::WKBConstants::wkbNDR);
+        auto nextRows = [&](QByteArray &rows) {
+            for (quint32 count = 0; count < batchSize && hasNext(); ++count) {
+                SPFeatureI feature;
+                if ( delta) {
+                    feature = *changedIter;
+                    ++changedIter;
                 } else {
-                    geos::geom::Geometry *subGeometry = createGeometry(query, geomName, crs);
-                    rootFeature->createSubFeature(geomName,subGeometry);
+                    feature = *featureIter;
+                    ++featureIter;
+                }
+                QStringList fields;
+                Record record = feature->record();
+                for (int i = 0 ; i < feature->attributeColumnCount() ; i++) {
+                    fields.append(sqlHelper.copyValueString(record.cell(i), feature->attributedefinition(i)));
+                }
+                foreach (MetaGeometryColumn geomMeta, metaGeomColumns) {
+                    QString geomColumn = geomMeta.geomColumn;
+                    geos::geom::Geometry *geometry = nullptr;
+                    if (rootGeomColumn == geomColumn) {
+                        geometry = feature->geometry().get();
+                    } else if (feature[geomColumn]->geometry() != nullptr) {
+                        geometry = feature[geomColumn]->geometry().get();
+                    }
+                    // hex ewkb, so the srid of the column is kept and no precision is lost
+                    fields.append(geometry == nullptr
+                                  ? "\\N"
+                                  : hexEwkb(wkbWriter, geometry, geomMeta.srid));
                 }
-                ++iter;
+                rows.append(fields.join("\t").toUtf8()).append('\n');
             }
+            return hasNext();
+        };
+
+        QString copyStmt = QString("COPY %1 ( %2 ) FROM STDIN").arg(tmpTable).arg(columns.join(", "));
+        if ( !pgUtil.copyIn(copyStmt, nextRows, connection)) {
+            pgUtil.endTransaction(false, connection);
+            return false;
+        }
+
+        sqlHelper.addUpsertStmt(tmpTable, columns);
+        QSqlQuery upsertQuery = pgUtil.doQuery(sqlHelper.sql(), connection);
+        sqlHelper.clearStatements();
+        if ( !upsertQuery.isActive()) {
+            pgUtil.endTransaction(false, connection);
+            return false;
         }
     }
-    fcoverage->attributesFromTable(table);
 
+    if ( !pgUtil.endTransaction(true, connection)) {
+        return false;
+    }
+    if ( delta) {
+        tracker->commit();
+    }
     return true;
 }
 
-bool PostgresqlFeatureCoverageLoader::storeData(FeatureCoverage *fcoverage) const
+bool PostgresqlFeatureCoverageLoader::deleteFeatures(const PostgresqlDatabaseUtil &pgUtil, SqlStatementHelper &sqlHelper, const ITable &baseData, const QStringList &keyColumns, const std::vector<QVariantList> &keys, const QString &connection) const
+{
+    QString tmpTable = "ilwis_feature_delete";
+    sqlHelper.addCreateTempTableStmt(tmpTable);
+    QSqlQuery createQuery = pgUtil.doQuery(sqlHelper.sql(), connection);
+    sqlHelper.clearStatements();
+    if ( !createQuery.isActive()) {
+        return false;
+    }
+
+    std::vector<ColumnDefinition> keyDefinitions;
+    for(const QString& column : keyColumns) {
+        keyDefinitions.push_back(baseData->columndefinition(column));
+    }
+    auto keyIter = keys.begin();
+    auto nextRows = [&](QByteArray &rows) {
+        for (quint32 count = 0; count < pgUtil.fetchSize() && keyIter != keys.end(); ++count, ++keyIter) {
+            QStringList fields;
+            for(quint32 i = 0; i < keyDefinitions.size(); ++i) {
+                fields.append(sqlHelper.copyValueString(keyIter->value(i), keyDefinitions[i]));
+            }
+            rows.append(fields.join("\t").toUtf8()).append('\n');
+        }
+        return keyIter != keys.end();
+    };
+    QString copyStmt = QString("COPY %1 ( %2 ) FROM STDIN").arg(tmpTable).arg(keyColumns.join(", "));
+    if ( !pgUtil.copyIn(copyStmt, nextRows, connection)) {
+        return false;
+    }
+
+    sqlHelper.addDeleteStmt(tmpTable, baseData.ptr());
+    QSqlQuery deleteQuery = pgUtil.doQuery(sqlHelper.sql(), connection);
+    sqlHelper.clearStatements();
+    return deleteQuery.isActive();
+}
+
+bool PostgresqlFeatureCoverageLoader::storeFeatureByFeature(FeatureCoverage *fcoverage) const
 {
     bool queryOk = true;
     ITable baseData = fcoverage->attributeTable();
@@ -320,15 +737,49 @@ bool PostgresqlFeatureCoverageLoader::storeData(FeatureCoverage *fcoverage) cons
     return queryOk && featuresOk;
 }
 
-geos::geom::Geometry* PostgresqlFeatureCoverageLoader::createGeometry(QSqlQuery &query, QString geomColumn, ICoordinateSystem crs) const
+geos::geom::Geometry* PostgresqlFeatureCoverageLoader::createGeometry(FeatureCoverage *fcoverage, QSqlQuery &query, QString geomColumn, ICoordinateSystem crs) const
 {
-    // postgis wkb is different from ogc wkb
-    // => select ewkb, but this seems to be slower than selecting wkt
-    //ByteArray wkbBytes = variant.toByteArray();
-
     QVariant variant = query.value(geomColumn);
-    QString wkt = variant.toString();
-    return GeometryHelper::fromWKT(wkt,crs);
+    if ( variant.isNull()) {
+        return nullptr;
+    }
+    if ( !_binaryGeometries) {
+        return GeometryHelper::fromWKT(variant.toString(),crs);
+    }
+
+    // ewkb (unlike the ogc wkb of ST_AsBinary) keeps z values and is understood by the geos reader
+    QByteArray wkbBytes = variant.toByteArray();
+    geos::geom::Geometry *geometry = fromWKB(fcoverage, wkbBytes);
+    if ( geometry == nullptr) {
+        // let the database translate what we could not read ourselves
+        PostgresqlDatabaseUtil pgUtil(_resource,_options);
+        QString sqlBuilder;
+        sqlBuilder.append("SELECT ST_AsText(ST_GeomFromEWKB(decode('");
+        sqlBuilder.append(QString::fromLatin1(wkbBytes.toHex()));
+        sqlBuilder.append("', 'hex'))) AS wkt;");
+        QSqlQuery wktQuery = pgUtil.doQuery(sqlBuilder, "featurecoverageloader.wkt");
+        if ( !wktQuery.next()) {
+            return nullptr;
+        }
+        return GeometryHelper::fromWKT(wktQuery.value("wkt").toString(),crs);
+    }
+    GeometryHelper::setCoordinateSystem(geometry, crs.ptr());
+    return geometry;
+}
+
+geos::geom::Geometry* PostgresqlFeatureCoverageLoader::fromWKB(FeatureCoverage *fcoverage, const QByteArray &wkb) const
+{
+    if ( wkb.isEmpty()) {
+        return nullptr;
+    }
+    try {
+        geos::io::WKBReader reader(*fcoverage->geomfactory());
+        std::istringstream stream(std::string(wkb.constData(), wkb.size()), std::ios_base::binary);
+        return reader.read(stream);
+    } catch(const geos::util::GEOSException& ex) {
+        kernel()->issues()->log(TR("Could not read binary geometry: %1").arg(ex.what()),IssueObject::itWarning);
+    }
+    return nullptr;
 }
 
 
@@ -342,6 +793,11 @@ void PostgresqlFeatureCoverageLoader::setFeatureCount(FeatureCoverage *fcoverage
     pgUtil.getMetaForGeometryColumns(metaGeometries);
     pgUtil.prepareSubFeatureSemantics(semantics, metaGeometries);
 
+    QString where;
+    if ( !pgUtil.whereClause(where)) {
+        return;
+    }
+
     int level = -1;
     QSqlQuery query;
     foreach (MetaGeometryColumn meta, metaGeometries) {
@@ -354,7 +810,7 @@ void PostgresqlFeatureCoverageLoader::setFeatureCount(FeatureCoverage *fcoverage
         sqlBuilder.append(" * ");
         sqlBuilder.append(" FROM ");
         sqlBuilder.append(meta.qtablename());
-        sqlBuilder.append(" WHERE NOT ");
+        sqlBuilder.append(where.isEmpty() ? " WHERE NOT " : where + " AND NOT ");
         sqlBuilder.append(" ST_isEmpty( ");
         sqlBuilder.append(meta.geomColumn);
         sqlBuilder.append(" ) ");
@@ -396,6 +852,10 @@ void PostgresqlFeatureCoverageLoader::setSpatialMetadata(FeatureCoverage *fcover
 
     Envelope bbox;
     ICoordinateSystem crs;
+    QString where;
+    if ( !pgUtil.whereClause(where)) {
+        return;
+    }
 
     foreach (MetaGeometryColumn meta, metaGeometries) {
         QString sqlBuilder;
@@ -405,6 +865,7 @@ void PostgresqlFeatureCoverageLoader::setSpatialMetadata(FeatureCoverage *fcover
         sqlBuilder.append(" ) ");
         sqlBuilder.append(" FROM ");
         sqlBuilder.append(meta.qtablename());
+        sqlBuilder.append(where);
         sqlBuilder.append(";");
         //qDebug() << "SQL: " << sqlBuilder;
 
@@ -6,6 +6,8 @@ namespace Ilwis {
 namespace Postgresql {
 
 struct MetaGeometryColumn;
+class PostgresqlDatabaseUtil;
+class SqlStatementHelper;
 
 class PostgresqlFeatureCoverageLoader
 {
@@ -18,15 +20,34 @@ public:
     bool storeData(FeatureCoverage *fcoverage) const;
 
 private:
+    struct GeometryColumn {
+        QString _name;
+        ICoordinateSystem _crs;
+    };
+
     Resource _resource;
     IOOptions _options;
+    bool _binaryGeometries = true;
 
+    bool bulkStoreData(FeatureCoverage *fcoverage) const;
+    bool deleteFeatures(const PostgresqlDatabaseUtil &pgUtil, SqlStatementHelper &sqlHelper, const ITable &baseData, const QStringList &keyColumns, const std::vector<QVariantList> &keys, const QString &connection) const;
+    bool storeFeatureByFeature(FeatureCoverage *fcoverage) const;
+    void trackChanges(FeatureCoverage *fcoverage, const PostgresqlDatabaseUtil &pgUtil, const std::vector<GeometryColumn> &columns) const;
     void setFeatureCount(FeatureCoverage *fcoverage) const;
     void setSpatialMetadata(FeatureCoverage *fcoverage) const;
     void setSubfeatureSemantics(Ilwis::FeatureCoverage *fcoverage, Ilwis::IDomain &semantics) const;
 
-    QString selectGeometries(const QList<MetaGeometryColumn> &metaGeometry) const;
-    geos::geom::Geometry* createGeometry(QSqlQuery &query, QString geomColumn, ICoordinateSystem crs) const;
+    std::vector<GeometryColumn> orderedGeometryColumns(const IDomain &semantics, const QList<MetaGeometryColumn> &metaGeometries) const;
+    void addFeature(FeatureCoverage *fcoverage, const std::vector<GeometryColumn> &columns, const std::vector<geos::geom::Geometry *> &geometries) const;
+    bool loadSequential(FeatureCoverage *fcoverage, ITable &table, const QList<MetaGeometryColumn> &metaGeometries, const std::vector<GeometryColumn> &columns) const;
+    bool loadPartitioned(FeatureCoverage *fcoverage, ITable &table, const QList<MetaGeometryColumn> &metaGeometries, const std::vector<GeometryColumn> &columns, quint32 partitions) const;
+    bool loadPage(FeatureCoverage *fcoverage, ITable &table, const std::vector<GeometryColumn> &columns) const;
+    quint32 partitionCount(const PostgresqlDatabaseUtil &pgUtil) const;
+
+    QString geometryColumns(const QList<MetaGeometryColumn> &metaGeometry) const;
+    QString selectFeatures(const ITable &table, const QList<MetaGeometryColumn> &metaGeometries, std::vector<QString> &attributeColumns) const;
+    geos::geom::Geometry* createGeometry(FeatureCoverage *fcoverage, QSqlQuery &query, QString geomColumn, ICoordinateSystem crs) const;
+    geos::geom::Geometry* fromWKB(FeatureCoverage *fcoverage, const QByteArray &wkb) const;
 };
 
 
@@ -0,0 +1,246 @@
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QList>
+
+#include "kernel.h"
+#include "resource.h"
+#include "geometries.h"
+#include "ilwisdata.h"
+#include "coordinatesystem.h"
+
+#include "postgresqldatabaseutil.h"
+#include "postgresqlfeaturepager.h"
+
+using namespace Ilwis;
+using namespace Postgresql;
+
+PostgresqlFeaturePager::PostgresqlFeaturePager(const Resource &resource, const IOOptions &options, const QStringList &attributeColumns, const QStringList &geometryColumns) :
+    _resource(resource),
+    _options(options),
+    _attributeColumns(attributeColumns),
+    _geometryColumns(geometryColumns)
+{
+    PostgresqlDatabaseUtil pgUtil(_resource, _options);
+    QList<QString> primaryKeys;
+    pgUtil.getPrimaryKeys(primaryKeys);
+    // without a primary key the physical row position is the only stable key
+    _keyColumns = primaryKeys.isEmpty() ? QStringList("ctid") : QStringList(primaryKeys);
+    pgUtil.whereClause(_where);
+
+    if ( _options.contains("pg.page.size")) {
+        _pageSize = std::max(1u, _options["pg.page.size"].toUInt());
+    }
+    if ( _options.contains("pg.page.cache")) {
+        _maxPages = std::max(1u, _options["pg.page.cache"].toUInt());
+    }
+}
+
+// the pagers in use, most recently used first; a pager holds at most _maxPages pages
+static std::list<std::pair<QString, std::shared_ptr<PostgresqlFeaturePager>>> pagers;
+static std::recursive_mutex pagersMutex;
+static const quint32 MAX_PAGERS = 32;
+
+QString PostgresqlFeaturePager::tableKey(const Resource &resource)
+{
+    return resource.url(true).toString() + "|";
+}
+
+std::shared_ptr<PostgresqlFeaturePager> PostgresqlFeaturePager::pager(const Resource &resource, const IOOptions &options, const QStringList &attributeColumns, const QStringList &geometryColumns)
+{
+    // pages are only shared between loads that select the same rows and columns
+    QString key = tableKey(resource);
+    for(QString option : {"pg.envelope", "pg.envelope.column", "pg.filter", "pg.page.size"}) {
+        key += (options.contains(option) ? options[option].toString() : "") + "|";
+    }
+    key += attributeColumns.join(",") + "|" + geometryColumns.join(",");
+
+    Locker<> lock(pagersMutex);
+    for(auto iter = pagers.begin(); iter != pagers.end(); ++iter) {
+        if ( iter->first == key) {
+            pagers.splice(pagers.begin(), pagers, iter);
+            return pagers.front().second;
+        }
+    }
+    pagers.push_front(std::make_pair(key, std::make_shared<PostgresqlFeaturePager>(resource, options, attributeColumns, geometryColumns)));
+    if ( pagers.size() > MAX_PAGERS) {
+        pagers.pop_back();
+    }
+    return pagers.front().second;
+}
+
+void PostgresqlFeaturePager::invalidate(const Resource &resource)
+{
+    QString key = tableKey(resource);
+    Locker<> lock(pagersMutex);
+    pagers.remove_if([&](const std::pair<QString, std::shared_ptr<PostgresqlFeaturePager>>& entry) {
+        return entry.first.startsWith(key);
+    });
+}
+
+QStringList PostgresqlFeaturePager::keyColumns() const
+{
+    return _keyColumns;
+}
+
+quint32 PostgresqlFeaturePager::pageSize() const
+{
+    return _pageSize;
+}
+
+PostgresqlFeaturePager::Page PostgresqlFeaturePager::page(quint64 index)
+{
+    Locker<> lock(_mutex);
+    for(auto iter = _pages.begin(); iter != _pages.end(); ++iter) {
+        if ( iter->first == index) {
+            _pages.splice(_pages.begin(), _pages, iter);
+            return _pages.front().second;
+        }
+    }
+
+    // the start of a page is the end of the previous one
+    if ( index > 0 && !findPageEnd(index - 1)) {
+        return Page(new std::vector<Row>()); // beyond the last page
+    }
+    Page newPage = readPage(index);
+    if ( !newPage) {
+        return newPage;
+    }
+    _pages.push_front(std::make_pair(index, newPage));
+    if ( _pages.size() > _maxPages) {
+        _pages.pop_back();
+    }
+    return newPage;
+}
+
+bool PostgresqlFeaturePager::row(const QVariantList &key, Row &row)
+{
+    if ( key.size() != _keyColumns.size()) {
+        ERROR2(ERR_ILLEGAL_VALUE_2, "feature key", QStringList(_keyColumns).join(","));
+        return false;
+    }
+    QString where = _where + (_where.isEmpty() ? " WHERE " : " AND ") + keyPredicate("=", key.size());
+    QString stmt = select(where) + " LIMIT 1";
+
+    PostgresqlDatabaseUtil pgUtil(_resource, _options);
+    QSqlQuery query = pgUtil.doPreparedQuery(stmt, key, "featurepager");
+    if ( !query.next()) {
+        return false;
+    }
+    row = toRow(query);
+    return true;
+}
+
+bool PostgresqlFeaturePager::findPageEnd(quint64 index)
+{
+    PostgresqlDatabaseUtil pgUtil(_resource, _options);
+    QStringList keys;
+    for(int i = 0; i < _keyColumns.size(); ++i) {
+        keys.append(QString("%1 AS ilwis_key_%2").arg(_keyColumns[i]).arg(i));
+    }
+
+    // walks from the last known boundary; only the keys are read, which an index can deliver
+    while ( _pageEnds.size() <= index && !_lastPageFound) {
+        QString where = _where;
+        QVariantList values;
+        if ( !_pageEnds.empty()) {
+            where += (where.isEmpty() ? " WHERE " : " AND ") + keyPredicate(">", _keyColumns.size());
+            values = _pageEnds.back();
+        }
+        QString stmt = QString("SELECT %1 FROM %2%3 ORDER BY %4 OFFSET %5 LIMIT 1")
+                .arg(keys.join(", "))
+                .arg(pgUtil.qTableFromTableResource())
+                .arg(where)
+                .arg(_keyColumns.join(", "))
+                .arg(_pageSize - 1);
+        QSqlQuery query = pgUtil.doPreparedQuery(stmt, values, "featurepager");
+        if ( !query.next()) {
+            _lastPageFound = true;
+            break;
+        }
+        QVariantList end;
+        for(int i = 0; i < _keyColumns.size(); ++i) {
+            end.append(query.value(i));
+        }
+        _pageEnds.push_back(end);
+    }
+    return _pageEnds.size() > index;
+}
+
+PostgresqlFeaturePager::Page PostgresqlFeaturePager::readPage(quint64 index)
+{
+    QString where = _where;
+    QVariantList values;
+    if ( index > 0) {
+        where += (where.isEmpty() ? " WHERE " : " AND ") + keyPredicate(">", _keyColumns.size());
+        values = _pageEnds[index - 1];
+    }
+    QString stmt = select(where) + QString(" LIMIT %1").arg(_pageSize);
+
+    PostgresqlDatabaseUtil pgUtil(_resource, _options);
+    QSqlQuery query = pgUtil.doPreparedQuery(stmt, values, "featurepager");
+    if ( !query.isActive()) {
+        return Page();
+    }
+    auto rows = std::make_shared<std::vector<Row>>();
+    rows->reserve(_pageSize);
+    while (query.next()) {
+        rows->push_back(toRow(query));
+    }
+    // a full page tells where the next one starts, no boundary query needed for that
+    if ( rows->size() == _pageSize && _pageEnds.size() == index) {
+        _pageEnds.push_back(rows->back()._key);
+    }
+    return rows;
+}
+
+QString PostgresqlFeaturePager::select(const QString &where) const
+{
+    QStringList columns;
+    for(int i = 0; i < _keyColumns.size(); ++i) {
+        columns.append(QString("%1 AS ilwis_key_%2").arg(_keyColumns[i]).arg(i));
+    }
+    for(const QString& column : _attributeColumns) {
+        if ( !column.isEmpty()) {
+            columns.append(column);
+        }
+    }
+    for(const QString& column : _geometryColumns) {
+        columns.append(QString("ST_AsEWKB(%1) AS %1").arg(column));
+    }
+
+    PostgresqlDatabaseUtil pgUtil(_resource, _options);
+    return QString("SELECT %1 FROM %2%3 ORDER BY %4")
+            .arg(columns.join(", "))
+            .arg(pgUtil.qTableFromTableResource())
+            .arg(where)
+            .arg(_keyColumns.join(", "));
+}
+
+QString PostgresqlFeaturePager::keyPredicate(const QString &op, int keyCount) const
+{
+    QStringList placeholders;
+    for(int i = 0; i < keyCount; ++i) {
+        placeholders.append(_keyColumns[i] == "ctid" ? "?::tid" : "?");
+    }
+    // a row comparison handles composite keys in key order
+    return QString("( %1 ) %2 ( %3 )").arg(_keyColumns.join(", ")).arg(op).arg(placeholders.join(", "));
+}
+
+PostgresqlFeaturePager::Row PostgresqlFeaturePager::toRow(QSqlQuery &query) const
+{
+    Row row;
+    for(int i = 0; i < _keyColumns.size(); ++i) {
+        row._key.append(query.value(QString("ilwis_key_%1").arg(i)));
+    }
+    row._record.resize(_attributeColumns.size());
+    for(int i = 0; i < _attributeColumns.size(); ++i) {
+        if ( !_attributeColumns[i].isEmpty()) {
+            row._record[i] = query.value(_attributeColumns[i]);
+        }
+    }
+    for(const QString& column : _geometryColumns) {
+        row._geometries.push_back(query.value(column).toByteArray());
+    }
+    return row;
+}
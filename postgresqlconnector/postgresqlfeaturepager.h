@@ -0,0 +1,73 @@
+#ifndef POSTGRESQLFEATUREPAGER_H
+#define POSTGRESQLFEATUREPAGER_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Ilwis {
+
+namespace Postgresql {
+
+/**
+ * @brief The PostgresqlFeaturePager reads a PostGIS table one page of features at a time.
+ *
+ * Pages are cut with keyset pagination on the primary key (or on ctid if the table has none):
+ * a page is selected with "WHERE key > last key of the previous page ORDER BY key LIMIT size",
+ * so reading page n does not make the database skip n pages of rows. The boundaries of the
+ * pages in between are found with key-only queries. The most recently used pages are kept
+ * (geometries as ewkb, they are decoded when a page is put into a coverage). A single feature
+ * can be fetched by its key with a point query.
+ */
+class PostgresqlFeaturePager
+{
+public:
+    struct Row {
+        QVariantList _key;
+        std::vector<QVariant> _record;
+        std::vector<QByteArray> _geometries;
+    };
+    typedef std::shared_ptr<const std::vector<Row>> Page;
+
+    PostgresqlFeaturePager(const Resource &resource, const IOOptions &options, const QStringList &attributeColumns, const QStringList &geometryColumns);
+
+    Page page(quint64 index);
+    bool row(const QVariantList &key, Row &row);
+    QStringList keyColumns() const;
+    quint32 pageSize() const;
+
+    static std::shared_ptr<PostgresqlFeaturePager> pager(const Resource &resource, const IOOptions &options, const QStringList &attributeColumns, const QStringList &geometryColumns);
+    /**
+     * @brief invalidate drops the pagers (and so the cached pages) of a table, to be called
+     * when the table has been written to.
+     */
+    static void invalidate(const Resource &resource);
+
+private:
+    Resource _resource;
+    IOOptions _options;
+    QStringList _attributeColumns;
+    QStringList _geometryColumns;
+    QStringList _keyColumns;
+    QString _where;
+    quint32 _pageSize = 1000;
+    quint32 _maxPages = 16;
+    std::vector<QVariantList> _pageEnds; // last key of every page found so far
+    bool _lastPageFound = false;
+    std::list<std::pair<quint64, Page>> _pages; // most recently used first
+    std::recursive_mutex _mutex;
+
+    bool findPageEnd(quint64 index);
+    Page readPage(quint64 index);
+    QString select(const QString &columns) const;
+    QString keyPredicate(const QString &op, int keyCount) const;
+    Row toRow(QSqlQuery &query) const;
+
+    static QString tableKey(const Resource &resource);
+};
+
+}
+}
+
+#endif // POSTGRESQLFEATUREPAGER_H
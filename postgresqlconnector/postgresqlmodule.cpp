@@ -18,6 +18,7 @@
 #include "postgresqlcatalogexplorer.h"
 #include "postgresqlfeatureconnector.h"
 #include "postgresqltableconnector.h"
+#include "postgresqlrasterconnector.h"
 #include "postgresqlmodule.h"
 
 using namespace Ilwis;
@@ -63,5 +64,6 @@ void PostgresqlModule::prepare()
     cfactory->addCreator("simplefeatures", "postgresql", PostgresqlFeatureConnector::create);
     cfactory->addCreator(itTABLE, "postgresql", PostgresqlTableConnector::create);
     cfactory->addCreator(itFEATURE, "postgresql", PostgresqlFeatureConnector::create);
+    cfactory->addCreator(itRASTER, "postgresql", PostgresqlRasterConnector::create);
     cfactory->addCreator(itCATALOG, "postgresql", CatalogConnector::create);
 }
@@ -40,6 +40,8 @@ bool PostgresqlObjectFactory::canUse(const Resource &resource) const
         return true;
     else if ( type & itTABLE)
         return true;
+    else if ( type & itRASTER)
+        return true;
     if ( type & itCATALOG)
         return true;
     return false;
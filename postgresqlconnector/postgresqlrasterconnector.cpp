@@ -0,0 +1,423 @@
+#include <cstring>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QtEndian>
+
+#include "kernel.h"
+#include "raster.h"
+#include "numericrange.h"
+#include "numericdomain.h"
+#include "coordinatesystem.h"
+#include "connectorinterface.h"
+#include "mastercatalog.h"
+#include "ilwisobjectconnector.h"
+#include "catalogexplorer.h"
+#include "catalogconnector.h"
+
+#include "postgresqlconnector.h"
+#include "postgresqldatabaseutil.h"
+#include "postgresqlrasterconnector.h"
+
+using namespace Ilwis;
+using namespace Postgresql;
+
+namespace {
+template<typename T> bool readRaw(const QByteArray &bytes, int &offset, bool littleEndian, T &value)
+{
+    if ( offset + (int)sizeof(T) > bytes.size()) {
+        return false;
+    }
+    T raw;
+    std::memcpy(&raw, bytes.constData() + offset, sizeof(T));
+    value = littleEndian ? qFromLittleEndian(raw) : qFromBigEndian(raw);
+    offset += sizeof(T);
+    return true;
+}
+
+bool readDouble(const QByteArray &bytes, int &offset, bool littleEndian, double &value)
+{
+    quint64 raw;
+    if ( !readRaw(bytes, offset, littleEndian, raw)) {
+        return false;
+    }
+    std::memcpy(&value, &raw, sizeof(double));
+    return true;
+}
+
+// postgis pixel types, see the WKT raster specification
+quint32 pixelSize(quint8 pixelType)
+{
+    switch(pixelType) {
+    case 0: case 1: case 2: case 3: case 4: return 1;
+    case 5: case 6: return 2;
+    case 7: case 8: case 10: return 4;
+    case 11: return 8;
+    default: return 0;
+    }
+}
+
+bool readPixel(const QByteArray &bytes, int &offset, bool littleEndian, quint8 pixelType, double &value)
+{
+    switch(pixelType) {
+    case 3: { qint8 v; if ( !readRaw(bytes, offset, littleEndian, v)) return false; value = v; return true; }
+    case 0: case 1: case 2: case 4: { quint8 v; if ( !readRaw(bytes, offset, littleEndian, v)) return false; value = v; return true; }
+    case 5: { qint16 v; if ( !readRaw(bytes, offset, littleEndian, v)) return false; value = v; return true; }
+    case 6: { quint16 v; if ( !readRaw(bytes, offset, littleEndian, v)) return false; value = v; return true; }
+    case 7: { qint32 v; if ( !readRaw(bytes, offset, littleEndian, v)) return false; value = v; return true; }
+    case 8: { quint32 v; if ( !readRaw(bytes, offset, littleEndian, v)) return false; value = v; return true; }
+    case 10: {
+        quint32 raw;
+        if ( !readRaw(bytes, offset, littleEndian, raw)) return false;
+        float v;
+        std::memcpy(&v, &raw, sizeof(float));
+        value = v;
+        return true;
+    }
+    case 11: return readDouble(bytes, offset, littleEndian, value);
+    default: return false;
+    }
+}
+}
+
+PostgresqlRasterConnector::PostgresqlRasterConnector(const Ilwis::Resource &resource, bool load, const IOOptions &options) : PostgresqlConnector(resource, load,options)
+{
+}
+
+PostgresqlRasterConnector::~PostgresqlRasterConnector()
+{
+}
+
+IlwisObject *PostgresqlRasterConnector::create() const
+{
+    return new RasterCoverage(_resource);
+}
+
+ConnectorInterface *PostgresqlRasterConnector::create(const Ilwis::Resource &resource, bool load,const IOOptions& options)
+{
+    return new PostgresqlRasterConnector(resource, load, options);
+}
+
+bool PostgresqlRasterConnector::loadMetaData(IlwisObject *data, const IOOptions &options)
+{
+    RasterCoverage *raster = static_cast<RasterCoverage *>(data);
+    IOOptions iooptions = options.isEmpty() ? this->ioOptions() : options;
+
+    Envelope envelope;
+    std::vector<QString> pixelTypes;
+    if ( !loadRasterMetadata(iooptions, envelope, pixelTypes)) {
+        ERROR1(ERR_NO_INITIALIZED_1, source().name());
+        return false;
+    }
+
+    PostgresqlDatabaseUtil pgUtil(source(), iooptions);
+    ICoordinateSystem crs;
+    pgUtil.prepareCoordinateSystem(QString::number(_srid), crs);
+    raster->coordinateSystem(crs);
+
+    Size<> rastersize(qRound((envelope.max_corner().x - envelope.min_corner().x) / std::abs(_scaleX)),
+                      qRound((envelope.max_corner().y - envelope.min_corner().y) / std::abs(_scaleY)),
+                      _bandCount);
+    std::vector<double> bands(_bandCount);
+    for(quint32 i = 0; i < _bandCount; ++i) {
+        bands[i] = i;
+    }
+    raster->stackDefinitionRef().setSubDefinition(IDomain("count"),bands);
+    raster->size(rastersize);
+
+    double vminRaster = rUNDEF, vmaxRaster = rUNDEF;
+    for(quint32 i = 0; i < _bandCount; ++i) {
+        raster->datadefRef(i) = createDataDef(pixelTypes[i], i, iooptions);
+        SPNumericRange range = raster->datadef(i).range<NumericRange>();
+        if ( !range.isNull()) {
+            vminRaster = Ilwis::min(range->min(), vminRaster);
+            vmaxRaster = Ilwis::max(range->max(), vmaxRaster);
+        }
+    }
+    double resolution = pixelTypes[0].endsWith("BF") ? 0 : 1;
+    raster->datadefRef() = DataDefinition(raster->datadef(0).domain(), new NumericRange(vminRaster, vmaxRaster, resolution));
+
+    QString grfcode = QString("code=georef:type=corners,csy=%1,envelope=%2,gridsize=%3 %4,name=%5")
+            .arg(QString("epsg:%1").arg(_srid))
+            .arg(envelope.toString())
+            .arg(rastersize.xsize())
+            .arg(rastersize.ysize())
+            .arg(source().name());
+    IGeoReference georeference;
+    if ( !georeference.prepare(grfcode)) {
+        return ERROR2(ERR_COULDNT_CREATE_OBJECT_FOR_2,"Georeference",raster->name() );
+    }
+    raster->envelope(envelope);
+    raster->georeference(georeference);
+
+    return true;
+}
+
+bool PostgresqlRasterConnector::loadRasterMetadata(const IOOptions &options, Envelope &envelope, std::vector<QString> &pixelTypes)
+{
+    PostgresqlDatabaseUtil pgUtil(source(), options);
+    QString qtablename = pgUtil.qTableFromTableResource();
+    QStringList parts = qtablename.split(".");
+
+    // raster_columns only knows scale, blocking and extent when the constraints were added (raster2pgsql -C)
+    QString sqlBuilder;
+    sqlBuilder.append("SELECT ");
+    sqlBuilder.append(" r_raster_column, srid, scale_x, scale_y, blocksize_y, num_bands, pixel_types, ");
+    sqlBuilder.append(" ST_XMin(extent) AS xmin, ST_YMin(extent) AS ymin, ST_XMax(extent) AS xmax, ST_YMax(extent) AS ymax ");
+    sqlBuilder.append(" FROM ");
+    sqlBuilder.append(" raster_columns ");
+    sqlBuilder.append(" WHERE ");
+    sqlBuilder.append(" r_table_schema = ? ");
+    sqlBuilder.append(" AND ");
+    sqlBuilder.append(" r_table_name = ? ");
+    sqlBuilder.append(" ;");
+
+    QSqlQuery query = pgUtil.doPreparedQuery(sqlBuilder, {parts.first(), parts.last()}, "rasterconnector");
+    if ( !query.next()) {
+        ERROR2(ERR_COULD_NOT_LOAD_2, qtablename, "raster column");
+        return false;
+    }
+    _rasterColumn = query.value("r_raster_column").toString();
+    _srid = query.value("srid").toInt();
+
+    if ( query.value("scale_x").isNull() || query.value("xmin").isNull()) {
+        // no constraints, derive the properties from the tiles themselves
+        QString fallback = QString("SELECT ST_ScaleX(%1) AS scale_x, ST_ScaleY(%1) AS scale_y, ST_Height(%1) AS blocksize_y, ST_NumBands(%1) AS num_bands, "
+                                   "array_to_string(ARRAY(SELECT ST_BandPixelType(%1, b) FROM generate_series(1, ST_NumBands(%1)) AS b), ',') AS pixel_types, "
+                                   "ST_SRID(%1) AS srid, ST_XMin(e) AS xmin, ST_YMin(e) AS ymin, ST_XMax(e) AS xmax, ST_YMax(e) AS ymax "
+                                   "FROM %2, (SELECT ST_Extent(ST_Envelope(%1)) AS e FROM %2) AS extent LIMIT 1;")
+                .arg(_rasterColumn).arg(qtablename);
+        query = pgUtil.doQuery(fallback, "rasterconnector");
+        if ( !query.next()) {
+            ERROR2(ERR_COULD_NOT_LOAD_2, qtablename, "raster tiles");
+            return false;
+        }
+        _srid = query.value("srid").toInt();
+    }
+
+    _scaleX = query.value("scale_x").toDouble();
+    _scaleY = query.value("scale_y").toDouble();
+    _tileHeight = std::max(1, query.value("blocksize_y").toInt());
+    _bandCount = std::max(1, query.value("num_bands").toInt());
+    envelope = Envelope(Coordinate(query.value("xmin").toDouble(), query.value("ymin").toDouble()),
+                        Coordinate(query.value("xmax").toDouble(), query.value("ymax").toDouble()));
+    // rasters are stored north up; the origin is the upper left corner
+    _originX = _scaleX > 0 ? envelope.min_corner().x : envelope.max_corner().x;
+    _originY = _scaleY < 0 ? envelope.max_corner().y : envelope.min_corner().y;
+
+    QString types = query.value("pixel_types").toString();
+    types.remove(QRegExp("[{}\"]"));
+    QStringList typeList = types.split(",", QString::SkipEmptyParts);
+    for(quint32 i = 0; i < _bandCount; ++i) {
+        pixelTypes.push_back(i < (quint32)typeList.size() ? typeList[i].trimmed() : "64BF");
+    }
+
+    if ( options.contains("pg.raster.cache")) {
+        _maxCachedRows = std::max(1u, options["pg.raster.cache"].toUInt());
+    }
+    return _scaleX != 0 && _scaleY != 0;
+}
+
+DataDefinition PostgresqlRasterConnector::createDataDef(const QString &pixelType, quint32 band, const IOOptions &options) const
+{
+    double vmin, vmax, resolution = 1;
+    if ( pixelType == "1BB") { vmin = 0; vmax = 1; }
+    else if ( pixelType == "2BUI") { vmin = 0; vmax = 3; }
+    else if ( pixelType == "4BUI") { vmin = 0; vmax = 15; }
+    else if ( pixelType == "8BSI") { vmin = -128; vmax = 127; }
+    else if ( pixelType == "8BUI") { vmin = 0; vmax = 255; }
+    else if ( pixelType == "16BSI") { vmin = -32768; vmax = 32767; }
+    else if ( pixelType == "16BUI") { vmin = 0; vmax = 65535; }
+    else if ( pixelType == "32BSI") { vmin = -2147483648.0; vmax = 2147483647.0; }
+    else if ( pixelType == "32BUI") { vmin = 0; vmax = 4294967295.0; }
+    else {
+        // floating point bands have no natural limits; a sample of the data gives them
+        resolution = 0;
+        vmin = vmax = rUNDEF;
+        PostgresqlDatabaseUtil pgUtil(source(), options);
+        // table and column go in as values, the names come from the resource and must not end up in the statement text
+        QString stmt = "SELECT min, max FROM ST_ApproxSummaryStats(?::text, ?::text, ?::integer, true, 0.1);";
+        QVariantList values = {pgUtil.qTableFromTableResource(), _rasterColumn, band + 1};
+        QSqlQuery query = pgUtil.doPreparedQuery(stmt, values, "rasterconnector");
+        if ( query.next()) {
+            vmin = query.value("min").toDouble();
+            vmax = query.value("max").toDouble();
+        }
+    }
+
+    QString domName = NumericDomain::standardNumericDomainName(vmin, vmax, resolution);
+    IDomain dom;
+    dom.prepare(domName);
+    if(!dom.isValid()) {
+        ERROR1(ERR_FIND_SYSTEM_OBJECT_1, domName);
+        return DataDefinition();
+    }
+    DataDefinition def;
+    def.domain(dom);
+    def.range(new NumericRange(vmin, vmax, dom->range<NumericRange>()->resolution()));
+    return def;
+}
+
+bool PostgresqlRasterConnector::loadData(IlwisObject *data, const IOOptions &options)
+{
+    Locker<> lock(_mutex);
+    IOOptions iooptions = options.isEmpty() ? ioOptions() : options;
+    RasterCoverage *raster = static_cast<RasterCoverage *>(data);
+
+    UPGrid& grid = raster->gridRef();
+    quint32 xsize = grid->size().xsize();
+    quint32 linesPerBlock = grid->maxLines();
+    std::map<quint32, std::vector<quint32> > blocklimits = grid->calcBlockLimits(iooptions);
+
+    for(const auto& layer : blocklimits){
+        for(const auto& index : layer.second) {
+            quint32 noItems = grid->blockSize(index);
+            if ( noItems == iUNDEF)
+                continue;
+            quint32 firstLine = (index - layer.first * grid->blocksPerBand()) * linesPerBlock;
+            quint32 lastLine = firstLine + noItems / xsize - 1;
+
+            std::vector<double> values(noItems, rUNDEF);
+            for(qint32 row = firstLine / _tileHeight; row <= (qint32)(lastLine / _tileHeight); ++row) {
+                TileRow tiles = tileRow(row, iooptions);
+                if ( !tiles) {
+                    return false;
+                }
+                fillBlock(values, firstLine, xsize, layer.first, *tiles);
+            }
+            grid->setBlockData(index, values, true);
+        }
+    }
+    _binaryIsLoaded = true;
+    return true;
+}
+
+PostgresqlRasterConnector::TileRow PostgresqlRasterConnector::tileRow(qint32 index, const IOOptions &options)
+{
+    for(auto iter = _tileRows.begin(); iter != _tileRows.end(); ++iter) {
+        if ( iter->first == index) {
+            _tileRows.splice(_tileRows.begin(), _tileRows, iter);
+            return _tileRows.front().second;
+        }
+    }
+
+    // the envelope is shrunk by half a pixel so that the tiles of the neighbouring rows, which only touch it, are left out
+    double ytop = _originY + index * _tileHeight * _scaleY;
+    double ybottom = ytop + _tileHeight * _scaleY;
+    double halfPixel = std::abs(_scaleY) / 2;
+    PostgresqlDatabaseUtil pgUtil(source(), options);
+    QString sqlBuilder;
+    sqlBuilder.append("SELECT ");
+    sqlBuilder.append(" ST_AsBinary(").append(_rasterColumn).append(") AS tile ");
+    sqlBuilder.append(" FROM ");
+    sqlBuilder.append(pgUtil.qTableFromTableResource());
+    sqlBuilder.append(" WHERE ");
+    sqlBuilder.append(_rasterColumn).append(" && ST_MakeEnvelope(?, ?, ?, ?, ?) ");
+    sqlBuilder.append(" ;");
+    QVariantList values = {-1e308, std::min(ytop, ybottom) + halfPixel, 1e308, std::max(ytop, ybottom) - halfPixel, _srid};
+
+    QSqlQuery query = pgUtil.doPreparedQuery(sqlBuilder, values, "rasterconnector");
+    if ( !query.isActive()) {
+        return TileRow();
+    }
+    TileRow tiles(new std::vector<RasterTile>());
+    while (query.next()) {
+        RasterTile tile;
+        if ( !decodeTile(query.value("tile").toByteArray(), tile)) {
+            ERROR2(ERR_COULD_NOT_LOAD_2, source().name(), "raster tile");
+            return TileRow();
+        }
+        tiles->push_back(std::move(tile));
+    }
+
+    _tileRows.push_front(std::make_pair(index, tiles));
+    if ( _tileRows.size() > _maxCachedRows) {
+        _tileRows.pop_back();
+    }
+    return tiles;
+}
+
+bool PostgresqlRasterConnector::decodeTile(const QByteArray &wkb, RasterTile &tile) const
+{
+    int offset = 0;
+    quint8 endian;
+    if ( !readRaw(wkb, offset, true, endian)) {
+        return false;
+    }
+    bool little = endian == 1;
+    quint16 version, bands, width, height;
+    double scaleX, scaleY, ipX, ipY, skewX, skewY;
+    qint32 srid;
+    bool ok = readRaw(wkb, offset, little, version) &&
+            readRaw(wkb, offset, little, bands) &&
+            readDouble(wkb, offset, little, scaleX) &&
+            readDouble(wkb, offset, little, scaleY) &&
+            readDouble(wkb, offset, little, ipX) &&
+            readDouble(wkb, offset, little, ipY) &&
+            readDouble(wkb, offset, little, skewX) &&
+            readDouble(wkb, offset, little, skewY) &&
+            readRaw(wkb, offset, little, srid) &&
+            readRaw(wkb, offset, little, width) &&
+            readRaw(wkb, offset, little, height);
+    if ( !ok) {
+        return false;
+    }
+
+    tile._column = qRound((ipX - _originX) / _scaleX);
+    tile._row = qRound((ipY - _originY) / _scaleY);
+    tile._width = width;
+    tile._height = height;
+    tile._bands.resize(bands);
+    for(quint16 band = 0; band < bands; ++band) {
+        quint8 flags;
+        if ( !readRaw(wkb, offset, little, flags)) {
+            return false;
+        }
+        quint8 pixelType = flags & 0x0F;
+        bool offline = flags & 0x80;
+        bool hasNodata = flags & 0x40;
+        if ( offline || pixelSize(pixelType) == 0) {
+            return false; // out-db bands are files on the database server, we can not read those
+        }
+        double nodata;
+        if ( !readPixel(wkb, offset, little, pixelType, nodata)) {
+            return false;
+        }
+        std::vector<double> &values = tile._bands[band];
+        values.resize((quint32)width * height);
+        for(double &value : values) {
+            if ( !readPixel(wkb, offset, little, pixelType, value)) {
+                return false;
+            }
+            if ( hasNodata && value == nodata) {
+                value = rUNDEF;
+            }
+        }
+    }
+    return true;
+}
+
+void PostgresqlRasterConnector::fillBlock(std::vector<double> &values, quint32 firstLine, quint32 xsize, quint32 band, const std::vector<RasterTile> &tiles) const
+{
+    qint32 lines = values.size() / xsize;
+    for(const RasterTile& tile : tiles) {
+        if ( band >= tile._bands.size()) {
+            continue;
+        }
+        const std::vector<double> &tileValues = tile._bands[band];
+        qint32 yfrom = std::max((qint32)firstLine, tile._row);
+        qint32 yto = std::min((qint32)firstLine + lines, tile._row + (qint32)tile._height);
+        qint32 xfrom = std::max(0, tile._column);
+        qint32 xto = std::min((qint32)xsize, tile._column + (qint32)tile._width);
+        for(qint32 y = yfrom; y < yto; ++y) {
+            for(qint32 x = xfrom; x < xto; ++x) {
+                values[(y - firstLine) * xsize + x] = tileValues[(y - tile._row) * tile._width + (x - tile._column)];
+            }
+        }
+    }
+}
+
+bool PostgresqlRasterConnector::store(IlwisObject *data, const IOOptions &options)
+{
+    return ERROR2(ERR_OPERATION_NOTSUPPORTED2, "write raster", source().name());
+}
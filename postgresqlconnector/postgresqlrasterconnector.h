@@ -0,0 +1,65 @@
+#ifndef POSTGRESQLRASTERCONNECTOR_H
+#define POSTGRESQLRASTERCONNECTOR_H
+
+#include <list>
+#include <mutex>
+
+namespace Ilwis {
+
+class RasterCoverage;
+
+namespace Postgresql {
+
+/**
+ * @brief The PostgresqlRasterConnector reads a PostGIS raster column as a raster coverage.
+ *
+ * The tiles of the column are expected to be regularly blocked (as created by raster2pgsql -t).
+ * For the grid blocks that are requested only the rows of tiles that intersect them are selected,
+ * transferred with ST_AsBinary and decoded on the client. Decoded rows of tiles are cached, as a
+ * row of tiles is usually higher than a grid block and would otherwise be fetched again for the next block.
+ */
+class PostgresqlRasterConnector : public PostgresqlConnector
+{
+public:
+    PostgresqlRasterConnector(const Ilwis::Resource &resource, bool load,const IOOptions& options=IOOptions());
+    ~PostgresqlRasterConnector();
+
+    IlwisObject *create() const;
+    static ConnectorInterface *create(const Ilwis::Resource &resource, bool load,const IOOptions& options=IOOptions());
+
+    bool loadMetaData(IlwisObject* data,const IOOptions& options=IOOptions());
+    bool loadData(IlwisObject *data, const IOOptions &options=IOOptions());
+    bool store(IlwisObject* data, const IOOptions &options);
+
+private:
+    struct RasterTile {
+        qint32 _column = 0; // pixel position of the upper left corner in the coverage
+        qint32 _row = 0;
+        quint32 _width = 0;
+        quint32 _height = 0;
+        std::vector<std::vector<double>> _bands;
+    };
+    typedef std::shared_ptr<std::vector<RasterTile>> TileRow;
+
+    QString _rasterColumn;
+    qint32 _srid = 0;
+    double _originX = 0;
+    double _originY = 0;
+    double _scaleX = 1;
+    double _scaleY = -1;
+    quint32 _tileHeight = 256;
+    quint32 _bandCount = 1;
+    quint32 _maxCachedRows = 8;
+    std::list<std::pair<qint32, TileRow>> _tileRows; // most recently used first
+    std::recursive_mutex _mutex;
+
+    bool loadRasterMetadata(const IOOptions &options, Envelope &envelope, std::vector<QString> &pixelTypes);
+    DataDefinition createDataDef(const QString &pixelType, quint32 band, const IOOptions &options) const;
+    TileRow tileRow(qint32 index, const IOOptions &options);
+    bool decodeTile(const QByteArray &wkb, RasterTile &tile) const;
+    void fillBlock(std::vector<double> &values, quint32 firstLine, quint32 xsize, quint32 band, const std::vector<RasterTile> &tiles) const;
+};
+}
+}
+
+#endif // POSTGRESQLRASTERCONNECTOR_H
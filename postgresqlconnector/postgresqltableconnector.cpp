@@ -19,6 +19,7 @@
 #include "postgresqlconnector.h"
 #include "postgresqltableconnector.h"
 #include "postgresqltableloader.h"
+#include "postgresqlfeaturepager.h"
 
 using namespace Ilwis;
 using namespace Postgresql;
@@ -64,6 +65,7 @@ bool PostgresqlTableConnector::store(IlwisObject *data, const IOOptions& options
     //qDebug() << "SQL: " << sqlHelper->sql();
 
     pgUtil.doQuery(sqlHelper.sql(), "upserting_table");
+    PostgresqlFeaturePager::invalidate(source());
 
     return true;
 }
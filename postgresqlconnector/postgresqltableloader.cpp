@@ -52,9 +52,13 @@ bool PostgresqlTableLoader::loadMetadata(Table *table) const
 
     QList<QString> primaryKeys;
     pgUtil.getPrimaryKeys(primaryKeys);
+    QStringList selectedColumns = pgUtil.selectedColumns();
 
     while (columnTypesQuery.next()) {
         QString columnName = columnTypesQuery.value(0).toString();
+        if ( !selectedColumns.isEmpty() && !selectedColumns.contains(columnName) && !primaryKeys.contains(columnName)) {
+            continue; // not projected
+        }
         if ( !createColumnDefinition(table, columnTypesQuery, primaryKeys)) {
             if ( !columnTypesQuery.isValid()) {
                 WARN("no data record selected.");
@@ -66,17 +70,22 @@ bool PostgresqlTableLoader::loadMetadata(Table *table) const
     return table->isValid();
 }
 
-QString PostgresqlTableLoader::select(QString columns) const
+bool PostgresqlTableLoader::select(QString columns, QString &sqlBuilder) const
 {
-    QString sqlBuilder;
     sqlBuilder.append("SELECT ");
     sqlBuilder.append(columns);
     sqlBuilder.append(" FROM ");
 
     PostgresqlDatabaseUtil pgUtil(_resource, _options);
     sqlBuilder.append(pgUtil.qTableFromTableResource());
+
+    QString where;
+    if ( !pgUtil.whereClause(where)) {
+        return false;
+    }
+    sqlBuilder.append(where);
     //qDebug() << "SQL: " << sqlBuilder;
-    return sqlBuilder;
+    return true;
 }
 
 bool PostgresqlTableLoader::loadData(Table *table) const
@@ -91,10 +100,9 @@ bool PostgresqlTableLoader::loadData(Table *table) const
     allNonGeometryColumns = allNonGeometryColumns.left(allNonGeometryColumns.length() - 1);
 
     PostgresqlDatabaseUtil pgUtil(_resource, _options);
-    QSqlQuery query = pgUtil.doQuery(select(allNonGeometryColumns), "tableloader.loadData");
 
     quint64 count = 0;
-    while (query.next()) {
+    auto toRecord = [&](QSqlQuery &query) {
         std::vector<QVariant> record(table->columnCount());
         for (int i = 0; i < table->columnCount(); i++) {
             ColumnDefinition& coldef = table->columndefinitionRef(i);
@@ -107,8 +115,13 @@ bool PostgresqlTableLoader::loadData(Table *table) const
             record[i] = query.value(coldef.name());
         }
         table->record(count++, record);
+        return true;
+    };
+    QString stmt;
+    if ( !select(allNonGeometryColumns, stmt)) {
+        return false;
     }
-    return true;
+    return pgUtil.doBatchedQuery(stmt, toRecord, "tableloader.loadData");
 }
 
 bool PostgresqlTableLoader::createColumnDefinition(Table *table, const QSqlQuery &query, QList<QString> &primaryKeys) const
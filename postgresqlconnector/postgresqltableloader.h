@@ -22,7 +22,7 @@ private:
     Resource _resource;
     IOOptions _options;
 
-    QString select(QString columns) const;
+    bool select(QString columns, QString &sqlBuilder) const;
     bool createColumnDefinition(Table *table, const QSqlQuery &query, QList<QString> &primaryKeys) const;
 };
 
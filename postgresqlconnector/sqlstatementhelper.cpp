@@ -153,8 +153,54 @@ void SqlStatementHelper::addDeleteStmt(const QString &tmpTable, const Table *tab
         ERROR1("No data table '%1' present.", tmpTable);
         return;
     }
+
+    // the temp table holds the keys of the rows to delete
+    QString sqlBuilder;
+    sqlBuilder.append(" DELETE FROM ");
+    sqlBuilder.append(_pgUtil.qTableFromTableResource());
+    sqlBuilder.append(" AS current ");
+    sqlBuilder.append(" USING ").append(tmpTable).append(" AS deleted ");
+    sqlBuilder.append(createWhereComparingPrimaryKeys("deleted", "current"));
+    sqlBuilder.append(" ; ");
+    _sqlBuilder.append(sqlBuilder);
 }
 
+void SqlStatementHelper::addUpsertStmt(const QString &tmpTable, const QStringList &columns)
+{
+    if ( !_tmpTables.contains(tmpTable)) {
+        ERROR1("No data table '%1' present.", tmpTable);
+        return;
+    }
+
+    // one set based statement instead of an exists check plus insert or update per row
+    QList<QString> primaryKeys;
+    _pgUtil.getPrimaryKeys(primaryKeys);
+    if ( primaryKeys.isEmpty()) {
+        // without a key the rows can not be matched, a plain insert would duplicate them
+        ERROR1("No primary key on table '%1'.", _pgUtil.qTableFromTableResource());
+        return;
+    }
+    QString columnList = QStringList(columns).join(", ");
+    QString sqlBuilder;
+    sqlBuilder.append(" INSERT INTO ");
+    sqlBuilder.append(_pgUtil.qTableFromTableResource());
+    sqlBuilder.append(" ( ").append(columnList).append(" ) ");
+    sqlBuilder.append(" SELECT ").append(columnList).append(" FROM ").append(tmpTable);
+    sqlBuilder.append(" ON CONFLICT ( ").append(QStringList(primaryKeys).join(", ")).append(" ) ");
+    QString updates;
+    foreach (QString column, columns) {
+        if ( !primaryKeys.contains(column)) {
+            updates.append(column).append(" = EXCLUDED.").append(column).append(", ");
+        }
+    }
+    if ( updates.isEmpty()) {
+        sqlBuilder.append(" DO NOTHING");
+    } else {
+        sqlBuilder.append(" DO UPDATE SET ").append(trimAndRemoveLastCharacter(updates));
+    }
+    sqlBuilder.append(" ; ");
+    _sqlBuilder.append(sqlBuilder);
+}
 
 QString SqlStatementHelper::sql()
 {
@@ -162,6 +208,12 @@ QString SqlStatementHelper::sql()
     return _sqlBuilder;
 }
 
+void SqlStatementHelper::clearStatements()
+{
+    // temp tables stay registered, they live until the end of the transaction
+    _sqlBuilder.clear();
+}
+
 QString SqlStatementHelper::createWhereComparingPrimaryKeys(const QString &aliasfirst, const QString &aliassecond) const
 {
     QString whereClause;
@@ -246,4 +298,49 @@ QString SqlStatementHelper::createInsertValueString(QVariant value, const Column
     }
 }
 
+QString SqlStatementHelper::copyValueString(QVariant value, const ColumnDefinition &coldef) const
+{
+    if ( !value.isValid() || value.isNull()) {
+        return "\\N";
+    }
+    IDomain domain = coldef.datadef().domain<>();
+    if (hasType(domain->valueType(),itINTEGER)) {
+
+        return QString::number(value.toLongLong());
+
+    } else if (hasType(domain->valueType(),itDOUBLE | itFLOAT)) {
+
+        return QString::number(value.toDouble(), 'g', 17);
+
+    } else if (hasType(domain->valueType(),itTHEMATICITEM | itNAMEDITEM | itINDEXEDITEM | itNUMERICITEM | itTIMEITEM)) {
+
+        return copyEscaped(domain->impliedValue(value).toString());
+
+    } else if (hasType(domain->valueType(), itDATETIME)) {
+        if ( QString(value.typeName()).compare("Ilwis::Time") != 0){
+            ERROR2(ERR_COULD_NOT_CONVERT_2,value.toString(), "time");
+            return "\\N";
+        }
+        Time time = value.value<Ilwis::Time>();
+        return time.toString(itDATETIME);
 
+    } else if (hasType(domain->valueType(),itSTRING)){
+
+        return copyEscaped(value.toString());
+
+    } else {
+        ERROR0("Could not determine data type.");
+        return "\\N";
+    }
+}
+
+QString SqlStatementHelper::copyEscaped(const QString &value) const
+{
+    // the text format of COPY only reserves the backslash and the field/row delimiters
+    QString escaped = value;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\t", "\\t");
+    escaped.replace("\n", "\\n");
+    escaped.replace("\r", "\\r");
+    return escaped;
+}
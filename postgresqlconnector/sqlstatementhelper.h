@@ -22,13 +22,17 @@ public:
     void addUpdateStmt(const QString &tmpTable, const Table *table);
     void addInsertStmt(const QString &tmpTable, const Table *table);
     void addDeleteStmt(const QString &tmpTable, const Table *table);
+    void addUpsertStmt(const QString &tmpTable, const QStringList &columns);
 
     QString columnNamesCommaSeparated(const Table *table) const;
     QString columnValuesCommaSeparated(const SPFeatureI feature) const;
     QString createInsertValueString(QVariant value, const ColumnDefinition &coldef) const;
+    QString copyValueString(QVariant value, const ColumnDefinition &coldef) const;
+    QString copyEscaped(const QString &value) const;
     QString trimAndRemoveLastCharacter(const QString &string) const;
 
     QString sql();
+    void clearStatements();
 
 private:
     PostgresqlDatabaseUtil _pgUtil;
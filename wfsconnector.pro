@@ -30,7 +30,8 @@ SOURCES += \
     wfsconnector/wfsfeaturedescriptionparser.cpp \
     wfsconnector/wfsparsingcontext.cpp \
     wfsconnector/wfscatalogexplorer.cpp \
-    wfsconnector/wfsconnection.cpp
+    wfsconnector/wfsconnection.cpp \
+    wfsconnector/wfsstreamdevice.cpp
 
 HEADERS += \
     wfsconnector/wfsobjectfactory.h \
@@ -46,7 +47,8 @@ HEADERS += \
     wfsconnector/wfsutils.h \
     wfsconnector/wfsparsingcontext.h \
     wfsconnector/wfscatalogexplorer.h \
-    wfsconnector/wfsconnection.h
+    wfsconnector/wfsconnection.h \
+    wfsconnector/wfsstreamdevice.h
 
 
 win32:CONFIG(release, debug|release): LIBS += -L$$PWD/../libraries/$$PLATFORM$$CONF/core/ -lilwiscore \
@@ -72,9 +72,12 @@ SPWfsResponse WebFeatureService::performSyncRequest(QUrl requestUrl) const
     SPWfsResponse response = SPWfsResponse(new WfsResponse);
     QNetworkReply *reply = response->performRequest(request, false);
 
-    QEventLoop loop; // waits for request to complete
+    QEventLoop loop; // waits for the first part of the response, the rest is received while it is parsed
     QObject::connect(reply, SIGNAL(readyRead()), &loop, SLOT(quit()));
-    loop.exec();
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    if ( !reply->isFinished()) {
+        loop.exec();
+    }
 
     response->readResponse(reply);
     return response;
@@ -7,6 +7,7 @@
 #include "geos/geom/LinearRing.h"
 #include "geos/geom/Polygon.h"
 #include "geos/geom/Point.h"
+#include "geos/geom/CoordinateArraySequence.h"
 
 #include "kernel.h"
 #include "coverage.h"
@@ -29,7 +30,6 @@
 #include "coverage.h"
 #include "featurecoverage.h"
 #include "feature.h"
-#include "geometryhelper.h"
 
 #include "xmlstreamparser.h"
 #include "wfsparsingcontext.h"
@@ -378,19 +378,18 @@ geos::geom::Point *WfsFeatureParser::parsePoint(bool &ok)
             ok = true;
             updateSrsInfo();
             initCrs(crs);
-            QString wkt;
-            gmlPosListToWktLineString(wkt, _parser->readElementText());
-            if (wkt.isEmpty()) {
+            geos::geom::CoordinateArraySequence *coords = parsePosList(_parser->readElementText());
+            if (coords->isEmpty()) {
+                delete coords;
                 WARN1("Parsed empty geometry at feature '%1'", _context.currentItem());
                 return _fcoverage->geomfactory()->createPoint();
             } else {
-                geos::geom::Geometry *geometry = GeometryHelper::fromWKT(wkt, crs);
-                return _fcoverage->geomfactory()->createPoint(geometry->getCoordinates());
+                return _fcoverage->geomfactory()->createPoint(coords);
             }
         }
         ERROR0("Could not find gml:pos");
     } catch(std::exception &e) {
-        ERROR1("Could not parse WKT Point %1", e.what());
+        ERROR1("Could not parse GML Point %1", e.what());
     }
 
     ok = false; // return empty point
@@ -405,19 +404,18 @@ geos::geom::LineString *WfsFeatureParser::parseLineString(bool &ok)
             ok = true;
             updateSrsInfo();
             initCrs(crs);
-            QString wkt;
-            gmlPosListToWktLineString(wkt, _parser->readElementText());
-            if (wkt.isEmpty()) {
+            geos::geom::CoordinateArraySequence *coords = parsePosList(_parser->readElementText());
+            if (coords->isEmpty()) {
+                delete coords;
                 WARN1("Parsed empty geometry at feature '%1'", _context.currentItem());
                 return _fcoverage->geomfactory()->createLineString();
             } else {
-                geos::geom::Geometry *geometry = GeometryHelper::fromWKT(wkt, crs);
-                return _fcoverage->geomfactory()->createLineString(geometry->getCoordinates());
+                return _fcoverage->geomfactory()->createLineString(coords);
             }
         }
         ERROR0("Could not neither find gml:posList nor gml:pos");
     } catch(std::exception &e) {
-        ERROR1("Could not parse WKT LineString %1", e.what());
+        ERROR1("Could not parse GML LineString %1", e.what());
     }
 
     ok = false; // return empty line string
@@ -432,7 +430,7 @@ geos::geom::Polygon * WfsFeatureParser::parsePolygon(bool &ok)
         std::vector<geos::geom::Geometry *> *inners = parseInteriorRings();
         return _fcoverage->geomfactory()->createPolygon(outer, inners);
     } catch(std::exception &e) {
-        ERROR1("Could not parse WKT Polygon %1", e.what());
+        ERROR1("Could not parse GML Polygon %1", e.what());
     }
 
     ok = false; // return empty polygon
@@ -441,20 +439,19 @@ geos::geom::Polygon * WfsFeatureParser::parsePolygon(bool &ok)
 
 geos::geom::LinearRing *WfsFeatureParser::parseExteriorRing()
 {
-    geos::geom::LinearRing *ring;
+    geos::geom::LinearRing *ring = 0;
 
     ICoordinateSystem crs;
     if (_parser->findNextOf( {"gml:exterior"} )) {
         if (_parser->findNextOf( {"gml:posList"} )) {
             initCrs(crs);
-            QString wkt;
-            gmlPosListToWktPolygon(wkt, _parser->readElementText());
-            if (wkt.isEmpty()) {
+            geos::geom::CoordinateArraySequence *coords = parsePosList(_parser->readElementText());
+            if (coords->isEmpty()) {
+                delete coords;
                 WARN1("Parsed empty geometry at feature '%1'", _context.currentItem());
                 ring = _fcoverage->geomfactory()->createLinearRing();
             } else {
-                geos::geom::Geometry *geometry = GeometryHelper::fromWKT(wkt, crs);
-                ring = _fcoverage->geomfactory()->createLinearRing(geometry->getCoordinates());
+                ring = _fcoverage->geomfactory()->createLinearRing(coords);
             }
             _parser->moveToEndOf("gml:exterior");
         }
@@ -471,14 +468,11 @@ std::vector<geos::geom::Geometry *> *WfsFeatureParser::parseInteriorRings()
         ICoordinateSystem crs;
         if (_parser->findNextOf( { "gml:posList" })) {
             initCrs(crs);
-            QString wkt;
-            gmlPosListToWktPolygon(wkt, _parser->readElementText());
-            if ( !wkt.isEmpty()) {
-                geos::geom::LinearRing *ring;
-                geos::geom::Geometry *geometry = GeometryHelper::fromWKT(wkt, crs);
-                ring = _fcoverage->geomfactory()->createLinearRing(geometry->getCoordinates());
-                innerRings->push_back(ring);
+            geos::geom::CoordinateArraySequence *coords = parsePosList(_parser->readElementText());
+            if ( !coords->isEmpty()) {
+                innerRings->push_back(_fcoverage->geomfactory()->createLinearRing(coords));
             } else {
+                delete coords;
                 WARN1("Parsed empty geometry at feature '%1'", _context.currentItem());
             }
             _parser->moveToEndOf("gml:interior");
@@ -487,67 +481,46 @@ std::vector<geos::geom::Geometry *> *WfsFeatureParser::parseInteriorRings()
     return innerRings;
 }
 
-QString WfsFeatureParser::gmlPosListToWktCoords(QString gmlPosList)
+geos::geom::CoordinateArraySequence *WfsFeatureParser::parsePosList(const QString &gmlPosList) const
 {
-    QString wktCoords;
-    QStringList coords = gmlPosList.split(" ");
-    if (_context.srsDimension() == 2) {
-        for (int i = 0; i < coords.size() - 1; i++) {
-            QString first = coords.at(i);
-            QString second = coords.at(++i);
-            if (!_swapAxesNeededToAlignInternXYOrder) {
-                wktCoords.append(first).append(" ");
-                wktCoords.append(second).append(" ");
-            } else {
-                wktCoords.append(second).append(" ");
-                wktCoords.append(first).append(" ");
-            }
-            wktCoords.append(", ");
+    // ordinates are converted straight from the element text; axis order and dimension are applied on the fly
+    int dimension = _context.srsDimension();
+    std::vector<geos::geom::Coordinate> *coords = new std::vector<geos::geom::Coordinate>();
+    if (dimension != 2 && dimension != 3) {
+        return new geos::geom::CoordinateArraySequence(coords);
+    }
+    coords->reserve(gmlPosList.size() / (dimension * 8));
+
+    const QChar *text = gmlPosList.constData();
+    int size = gmlPosList.size();
+    double ordinates[3];
+    int ordinate = 0;
+    for (int i = 0; i < size;) {
+        while (i < size && text[i].isSpace()) {
+            i++;
         }
-    } else if (_context.srsDimension() == 3) {
-        for (int i = 0; i < coords.size() - 2; i++) {
-            QString first = coords.at(i);
-            QString second = coords.at(++i);
-            QString third = coords.at(++i);
-            if (!_swapAxesNeededToAlignInternXYOrder) {
-                wktCoords.append(first).append(" ");
-                wktCoords.append(second).append(" ");
-            } else {
-                wktCoords.append(second).append(" ");
-                wktCoords.append(first).append(" ");
+        int start = i;
+        while (i < size && !text[i].isSpace()) {
+            i++;
+        }
+        if (start == i) {
+            break;
+        }
+        bool ok;
+        ordinates[ordinate++] = gmlPosList.midRef(start, i - start).toDouble(&ok);
+        if ( !ok) {
+            delete coords;
+            throw geos::io::ParseException("Invalid ordinate in posList", gmlPosList.mid(start, i - start).toStdString());
+        }
+        if (ordinate == dimension) {
+            if (_swapAxesNeededToAlignInternXYOrder) {
+                std::swap(ordinates[0], ordinates[1]);
             }
-            wktCoords.append(third);
-            wktCoords.append(", ");
+            coords->push_back(dimension == 3
+                              ? geos::geom::Coordinate(ordinates[0], ordinates[1], ordinates[2])
+                              : geos::geom::Coordinate(ordinates[0], ordinates[1]));
+            ordinate = 0;
         }
     }
-    return wktCoords.left(wktCoords.lastIndexOf(","));
+    return new geos::geom::CoordinateArraySequence(coords);
 }
-
-void WfsFeatureParser::gmlPosListToWktPolygon(QString &wkt, QString gmlPosList)
-{
-    if ( !gmlPosList.isEmpty()) {
-        wkt.append("POLYGON((");
-        wkt.append(gmlPosListToWktCoords(gmlPosList));
-        wkt.append("))");
-    }
-}
-
-void WfsFeatureParser::gmlPosListToWktLineString(QString &wkt, QString gmlPosList)
-{
-    if ( !gmlPosList.isEmpty()) {
-        wkt.append("LINESTRING(");
-        wkt.append(gmlPosListToWktCoords(gmlPosList));
-        wkt.append(")");
-    }
-}
-
-void WfsFeatureParser::gmlPosListToWktPoint(QString &wkt, QString gmlPosList)
-{
-    if ( !gmlPosList.isEmpty()) {
-        wkt.append("POINT(");
-        wkt.append(gmlPosListToWktCoords(gmlPosList));
-        wkt.append(")");
-    }
-}
-
-
@@ -2,6 +2,7 @@
 #define WFSFEATUREPARSER_H
 
 #include "geos/geom/Polygon.h"
+#include "geos/geom/CoordinateArraySequence.h"
 
 #include "wfsconnector_global.h"
 #include "wfsresponse.h"
@@ -86,10 +87,14 @@ private:
 
     void initCrs(ICoordinateSystem &crs);
 
-    QString gmlPosListToWktCoords(QString gmlPosList);
-    void gmlPosListToWktPolygon(QString &wkt, QString gmlPosList);
-    void gmlPosListToWktLineString(QString &wkt, QString gmlPosList);
-    void gmlPosListToWktPoint(QString &wkt, QString gmlPosList);
+    /**
+     * Converts the coordinates of a gml:pos or gml:posList element to a coordinate sequence.
+     * The srsDimension of the context decides how many ordinates make a coordinate; the axes
+     * are swapped when the crs has lat/lon order.
+     *
+     * @return the coordinates, empty if there were none; throws a ParseException on malformed ordinates.
+     */
+    geos::geom::CoordinateArraySequence *parsePosList(const QString &gmlPosList) const;
 };
 
 }
@@ -11,6 +11,7 @@
 
 #include "kernel.h"
 #include "wfsresponse.h"
+#include "wfsstreamdevice.h"
 #include "xpathparser.h"
 #include "xmlstreamparser.h"
 
@@ -135,7 +136,8 @@ void WfsResponse::readResponse(QNetworkReply *reply)
 {
     _connectionTimeout->stop();
     if (reply->error() == QNetworkReply::NoError) {
-        setDevice(reply);
+        // a reply that is still running is parsed while it is received
+        setDevice(reply->isFinished() ? static_cast<QIODevice *>(reply) : new WfsStreamDevice(reply, this));
     } else {
         QVariant statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
         QVariant reason = reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute);
@@ -0,0 +1,70 @@
+#include <QTimer>
+#include <QEventLoop>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include "kernel.h"
+#include "wfsstreamdevice.h"
+
+using namespace Ilwis;
+using namespace Wfs;
+
+WfsStreamDevice::WfsStreamDevice(QNetworkReply *reply, QObject *parent): QIODevice(parent), _reply(reply)
+{
+    // the reply stops receiving when this much is waiting to be parsed
+    _reply->setReadBufferSize(READ_BUFFER_SIZE);
+    open(QIODevice::ReadOnly);
+}
+
+bool WfsStreamDevice::isSequential() const
+{
+    return true;
+}
+
+bool WfsStreamDevice::atEnd() const
+{
+    return _reply->isFinished() && _reply->bytesAvailable() == 0 && QIODevice::atEnd();
+}
+
+qint64 WfsStreamDevice::bytesAvailable() const
+{
+    return _reply->bytesAvailable() + QIODevice::bytesAvailable();
+}
+
+qint64 WfsStreamDevice::readData(char *data, qint64 maxSize)
+{
+    if ( !waitForData()) {
+        return -1; // end of the reply
+    }
+    return _reply->read(data, maxSize);
+}
+
+qint64 WfsStreamDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+bool WfsStreamDevice::waitForData()
+{
+    if (_reply->bytesAvailable() == 0 && !_reply->isFinished()) {
+        QEventLoop loop;
+        QObject::connect(_reply, SIGNAL(readyRead()), &loop, SLOT(quit()));
+        QObject::connect(_reply, SIGNAL(finished()), &loop, SLOT(quit()));
+        QTimer::singleShot(TIMEOUT, &loop, SLOT(quit()));
+        loop.exec();
+        if (_reply->bytesAvailable() == 0 && !_reply->isFinished()) {
+            ERROR0("The request will stop due to timeout. Check your internet connection.");
+            _reply->abort();
+            return false;
+        }
+    }
+    if (_reply->bytesAvailable() > 0) {
+        return true;
+    }
+    if (_reply->error() != QNetworkReply::NoError && !_errorReported) {
+        _errorReported = true;
+        QVariant statusCode = _reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+        kernel()->issues()->log(TR("Response ended with error: %1 (%2)").arg(_reply->errorString()).arg(statusCode.toString()));
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef WFSSTREAMDEVICE_H
+#define WFSSTREAMDEVICE_H
+
+#include <QIODevice>
+
+#include "wfsconnector_global.h"
+
+class QNetworkReply;
+
+namespace Ilwis {
+namespace Wfs {
+
+/**
+ * Read-only device on top of a network reply which is still being received.<br/>
+ * <br/>
+ * A QXmlStreamReader reading a reply directly would stop with a PrematureEndOfDocumentError
+ * as soon as it has consumed the bytes received so far. This device waits (running a local
+ * event loop) for the next chunk instead, so a parser can pull the document as it arrives and
+ * only the chunks not parsed yet are held in memory. The end of the device is the end of the
+ * reply.
+ */
+class WFSCONNECTORSHARED_EXPORT WfsStreamDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    WfsStreamDevice(QNetworkReply *reply, QObject *parent=0);
+
+    bool isSequential() const;
+    bool atEnd() const;
+    qint64 bytesAvailable() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    static const qint64 READ_BUFFER_SIZE = 4 * 1024 * 1024;
+    static const int TIMEOUT = 30000; // ms without any data before the request is given up
+
+    QNetworkReply *_reply;
+    bool _errorReported = false;
+
+    /**
+     * Blocks until the reply has new data or has finished.
+     *
+     * @return true if there is data to read.
+     */
+    bool waitForData();
+};
+
+}
+}
+
+#endif // WFSSTREAMDEVICE_H